@@ -0,0 +1,38 @@
+#-----------------------------------------------------------------------------
+# Build-time generation of the ADC code -> joystick axis lookup table
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+# Voltage divider and stick range the table is generated for. The maximum must
+# stay at twice JOYSTICK_AXIS_CENTRE_RESISTANCE in joystick.h (checked at compile time)
+set(JOYSTICK_FIXED_RESISTOR_OHMS 10000 CACHE STRING "Fixed resistor in the axis voltage divider")
+set(JOYSTICK_AXIS_MAX_OHMS 110000 CACHE STRING "Stick resistance at full deflection")
+set(JOYSTICK_AXIS_DISCONNECT_PERCENT 150 CACHE STRING
+    "Stick resistance, as a percentage of full deflection, above which an axis reads as unplugged")
+
+find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+set(ADC_TABLE_GENERATOR ${CMAKE_CURRENT_LIST_DIR}/tools/gen_adc_table.py)
+
+set(ADC_TABLE_OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/generated)
+
+add_custom_command(
+        OUTPUT ${ADC_TABLE_OUTPUT_DIR}/adc_table.c ${ADC_TABLE_OUTPUT_DIR}/adc_table.h
+        COMMAND Python3::Interpreter ${ADC_TABLE_GENERATOR}
+                --fixed-ohms ${JOYSTICK_FIXED_RESISTOR_OHMS}
+                --max-ohms ${JOYSTICK_AXIS_MAX_OHMS}
+                --disconnect-percent ${JOYSTICK_AXIS_DISCONNECT_PERCENT}
+                --output-dir ${ADC_TABLE_OUTPUT_DIR}
+        DEPENDS ${ADC_TABLE_GENERATOR}
+        COMMENT "Generating ADC lookup table")
+
+# Generated once, however many targets use it
+add_custom_target(adc_table DEPENDS ${ADC_TABLE_OUTPUT_DIR}/adc_table.c ${ADC_TABLE_OUTPUT_DIR}/adc_table.h)
+
+# Add the generated adc_table.c/.h to the given target
+function(joystick_add_adc_table target)
+  add_dependencies(${target} adc_table)
+  target_sources(${target} PRIVATE ${ADC_TABLE_OUTPUT_DIR}/adc_table.c)
+  target_include_directories(${target} PUBLIC ${ADC_TABLE_OUTPUT_DIR})
+endfunction()
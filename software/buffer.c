@@ -6,38 +6,55 @@
 
 #include "buffer.h"
 
-#include "hardware/sync.h"
+#include "profile.h"
 #include "stdlib.h"
 
 //-----------------------------------------------------------------------------
 // Public functions
 //-----------------------------------------------------------------------------
 
-void buffer_init(buffer_t *buffer) {
+void buffer_init(buffer_t *buffer, uint16_t window) {
+  if (window < 1) {
+    window = 1;
+  } else if (window > BUFFER_MAX_WINDOW) {
+    window = BUFFER_MAX_WINDOW;
+  }
+
+  buffer->window = window;
   buffer->write_index = 0;
+  buffer->sum = 0;
 
-  for (int i = 0; i < BUFFER_SIZE; i++) {
+  for (int i = 0; i < BUFFER_MAX_WINDOW; i++) {
     buffer->values[i] = 0;
   }
 }
 
-void buffer_write(buffer_t *buffer, float value) {
-  uint32_t interrupt_status = save_and_disable_interrupts();
-
-  buffer->values[buffer->write_index % BUFFER_SIZE] = value;
-  buffer->write_index++;
-
-  restore_interrupts(interrupt_status);
+void buffer_fill(buffer_t *buffer, uint16_t value) {
+  for (int i = 0; i < buffer->window; i++) {
+    buffer->values[i] = value;
+  }
+  buffer->sum = (uint32_t)value * buffer->window;
+  buffer->write_index = 0;
 }
 
-float buffer_average(buffer_t *buffer) {
-  float sum = 0;
+void buffer_write(buffer_t *buffer, uint16_t value) {
+  PROFILE_SCOPE(PROFILE_BUFFER_WRITE);
+  uint16_t index = buffer->write_index;
 
-  uint32_t interrupt_status = save_and_disable_interrupts();
-  for (int i = 0; i < BUFFER_SIZE; i++) {
-    sum += buffer->values[i];
-  }
-  restore_interrupts(interrupt_status);
+  // Swap the oldest value out of the running sum. The sum is a single aligned
+  // word store, so readers always see either the old or the new total.
+  buffer->sum = buffer->sum - buffer->values[index] + value;
+  buffer->values[index] = value;
+
+  // The window need not be a power of two, so wrap with a compare rather
+  // than a modulo. That saves one of the two divides per sample, the other
+  // being in buffer_average().
+  index++;
+  buffer->write_index = (index == buffer->window) ? 0 : index;
+}
 
-  return sum / BUFFER_SIZE;
+uint16_t buffer_average(buffer_t *buffer) {
+  PROFILE_SCOPE(PROFILE_BUFFER_AVERAGE);
+  uint32_t sum = buffer->sum;
+  return (uint16_t)((sum + buffer->window / 2) / buffer->window);
 }
@@ -14,28 +14,38 @@
 // Public constants
 //-----------------------------------------------------------------------------
 
-#define BUFFER_SIZE 10
+// Storage reserved per buffer, the longest window that can be requested
+#define BUFFER_MAX_WINDOW 256
 
 //-----------------------------------------------------------------------------
 // Public types
 //-----------------------------------------------------------------------------
 
+// The running sum is updated on every write, so reading the average costs the
+// same for any window length. Each buffer supports a single writer, and any
+// number of readers that may interrupt it.
 typedef struct {
-  uint32_t write_index;
-  float values[BUFFER_SIZE];
+  uint16_t window;
+  uint16_t write_index;
+  volatile uint32_t sum;
+  uint16_t values[BUFFER_MAX_WINDOW];
 } buffer_t;
 
 //-----------------------------------------------------------------------------
 // Public functions
 //-----------------------------------------------------------------------------
 
-// Set the buffer entries to defined  values
-void buffer_init(buffer_t *buffer);
+// Set the buffer entries to defined values, averaging over the given number of
+// samples (clamped to 1 - BUFFER_MAX_WINDOW)
+void buffer_init(buffer_t *buffer, uint16_t window);
+
+// Set every entry to the given value, so the average is that value straight away
+void buffer_fill(buffer_t *buffer, uint16_t value);
 
 // Writes the provided value to the oldest slot in the buffer
-void buffer_write(buffer_t *buffer, float value);
+void buffer_write(buffer_t *buffer, uint16_t value);
 
-// Calculate the average of all entries in the buffer
-float buffer_average(buffer_t *buffer);
+// Calculate the rounded average of all entries in the buffer
+uint16_t buffer_average(buffer_t *buffer);
 
 #endif  // __BUFFER_H__
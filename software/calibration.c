@@ -0,0 +1,341 @@
+//-----------------------------------------------------------------------------
+// Per-axis joystick calibration, stored in flash and applied by table lookup
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "calibration.h"
+
+#include <string.h>
+
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "pico/time.h"
+#include "profile.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+// Settings live in the last sector of flash, well clear of the program image
+#define CALIBRATION_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define CALIBRATION_MAGIC 0x4A434131  // "JCA1"
+#define CALIBRATION_VERSION 1
+
+// Response tables sample the 16-bit axis range every 256 values, with linear
+// interpolation in between
+#define TABLE_SHIFT 8
+#define TABLE_SIZE ((1 << (16 - TABLE_SHIFT)) + 1)
+
+// Without a stored calibration, assume the stick only covers the middle of
+// the nominal range, and learn the true extremes as they are reached
+#define DEFAULT_MARGIN (JOYSTICK_AXIS_FULL_SCALE / 8)
+#define DEFAULT_CENTRE ((JOYSTICK_AXIS_FULL_SCALE + 1) / 2)
+
+// Newly learnt extremes are folded into the tables at most this often
+#define LEARN_REBUILD_INTERVAL_US 100000
+
+// Smallest span accepted either side of the centre, to avoid dividing by zero
+#define MIN_HALF_SPAN 256
+
+//-----------------------------------------------------------------------------
+// Private types
+//-----------------------------------------------------------------------------
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  calibration_axis_t axes[CALIBRATION_NUM_AXES];
+  uint32_t checksum;
+} calibration_record_t;
+
+typedef enum {
+  MODE_NORMAL,
+  MODE_COMBO_HELD,    // Both buttons down, waiting for the hold time
+  MODE_WAIT_RELEASE,  // Calibration started, waiting for the buttons to be let go
+  MODE_CALIBRATING,   // Recording extremes until a button is pressed
+} calibration_mode_t;
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static calibration_axis_t settings[CALIBRATION_NUM_AXES];
+static int16_t tables[CALIBRATION_NUM_AXES][TABLE_SIZE];
+
+static calibration_mode_t mode = MODE_NORMAL;
+static uint32_t combo_start_us;
+static calibration_axis_t pending[CALIBRATION_NUM_AXES];
+
+static bool learn_dirty = false;
+static uint32_t last_rebuild_us;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+// FNV-1a over the record, excluding the checksum itself
+static uint32_t record_checksum(const calibration_record_t *record) {
+  const uint8_t *bytes = (const uint8_t *)record;
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < offsetof(calibration_record_t, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static void default_settings(calibration_axis_t *axis) {
+  axis->min = DEFAULT_MARGIN;
+  axis->centre = DEFAULT_CENTRE;
+  axis->max = JOYSTICK_AXIS_FULL_SCALE - DEFAULT_MARGIN;
+  axis->deadzone_permille = 0;
+  axis->curve_percent = 0;
+}
+
+// Keep the settings usable whatever they were loaded or set from
+static void sanitise_settings(calibration_axis_t *axis) {
+  if (axis->centre < MIN_HALF_SPAN) {
+    axis->centre = MIN_HALF_SPAN;
+  } else if (axis->centre > JOYSTICK_AXIS_FULL_SCALE - MIN_HALF_SPAN) {
+    axis->centre = JOYSTICK_AXIS_FULL_SCALE - MIN_HALF_SPAN;
+  }
+  if (axis->min > axis->centre - MIN_HALF_SPAN) {
+    axis->min = axis->centre - MIN_HALF_SPAN;
+  }
+  if (axis->max < axis->centre + MIN_HALF_SPAN) {
+    axis->max = axis->centre + MIN_HALF_SPAN;
+  }
+  if (axis->deadzone_permille > 999) {
+    axis->deadzone_permille = 999;
+  }
+  if (axis->curve_percent > 100) {
+    axis->curve_percent = 100;
+  }
+}
+
+// Response for a single axis value, in Q15 fixed point
+static int32_t response(const calibration_axis_t *axis, int32_t value) {
+  // Position within the relevant half of travel, -32768 to 32768
+  int32_t position;
+  if (value < axis->centre) {
+    position = -(int32_t)(((int64_t)(axis->centre - value) << 15) / (axis->centre - axis->min));
+  } else {
+    position = (int32_t)(((int64_t)(value - axis->centre) << 15) / (axis->max - axis->centre));
+  }
+
+  int32_t magnitude = position < 0 ? -position : position;
+  if (magnitude > (1 << 15)) {
+    magnitude = 1 << 15;
+  }
+
+  // Deadzone, rescaled so the output still reaches full scale
+  int32_t deadzone = (axis->deadzone_permille << 15) / 1000;
+  if (magnitude <= deadzone) {
+    return 0;
+  }
+  magnitude = ((magnitude - deadzone) << 15) / ((1 << 15) - deadzone);
+
+  // Blend of x and x^3
+  int32_t cubic = (int32_t)(((int64_t)magnitude * magnitude >> 15) * magnitude >> 15);
+  magnitude = (magnitude * (100 - axis->curve_percent) + cubic * axis->curve_percent) / 100;
+
+  if (magnitude > CALIBRATION_OUTPUT_MAX) {
+    magnitude = CALIBRATION_OUTPUT_MAX;
+  }
+  return position < 0 ? -magnitude : magnitude;
+}
+
+static void build_table(uint8_t axis) {
+  for (int i = 0; i < TABLE_SIZE; i++) {
+    int32_t value = i << TABLE_SHIFT;
+    if (value > JOYSTICK_AXIS_FULL_SCALE) {
+      value = JOYSTICK_AXIS_FULL_SCALE;
+    }
+    tables[axis][i] = (int16_t)response(&settings[axis], value);
+  }
+}
+
+// Widen an axis' range if the stick has gone past it
+static bool learn_extremes(calibration_axis_t *axis, uint16_t value) {
+  if (value < axis->min) {
+    axis->min = value;
+    return true;
+  }
+  if (value > axis->max) {
+    axis->max = value;
+    return true;
+  }
+  return false;
+}
+
+static void read_axes(const joystick_state_t *state, uint16_t values[CALIBRATION_NUM_AXES]) {
+  values[CALIBRATION_AXIS_X] = state->x_axis;
+  values[CALIBRATION_AXIS_Y] = state->y_axis;
+#if CALIBRATION_NUM_AXES > 2
+  values[CALIBRATION_AXIS_X2] = state->x2_axis;
+  values[CALIBRATION_AXIS_Y2] = state->y2_axis;
+#endif
+}
+
+static void run_calibration_mode(const joystick_state_t *state, const uint16_t values[CALIBRATION_NUM_AXES],
+                                 uint32_t now_us) {
+  bool both_buttons = state->button_1 && state->button_2;
+
+  switch (mode) {
+    case MODE_NORMAL:
+      if (both_buttons) {
+        mode = MODE_COMBO_HELD;
+        combo_start_us = now_us;
+      }
+      break;
+
+    case MODE_COMBO_HELD:
+      if (!both_buttons) {
+        mode = MODE_NORMAL;
+      } else if (now_us - combo_start_us >= CALIBRATION_COMBO_HOLD_MS * 1000u) {
+        // Start from nothing, keeping the deadzone and curve settings
+        for (int axis = 0; axis < CALIBRATION_NUM_AXES; axis++) {
+          pending[axis] = settings[axis];
+          pending[axis].min = values[axis];
+          pending[axis].max = values[axis];
+        }
+        mode = MODE_WAIT_RELEASE;
+      }
+      break;
+
+    case MODE_WAIT_RELEASE:
+      if (!state->button_1 && !state->button_2) {
+        mode = MODE_CALIBRATING;
+      }
+      break;
+
+    case MODE_CALIBRATING:
+      for (int axis = 0; axis < CALIBRATION_NUM_AXES; axis++) {
+        learn_extremes(&pending[axis], values[axis]);
+      }
+
+      if (state->button_1) {
+        // The stick is back at rest while the button is pressed
+        for (int axis = 0; axis < CALIBRATION_NUM_AXES; axis++) {
+          pending[axis].centre = values[axis];
+          calibration_set(axis, &pending[axis]);
+        }
+        calibration_save();
+        mode = MODE_NORMAL;
+      } else if (state->button_2) {
+        mode = MODE_NORMAL;
+      }
+      break;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+void calibration_init(void) {
+  const calibration_record_t *record = (const calibration_record_t *)(XIP_BASE + CALIBRATION_FLASH_OFFSET);
+  bool valid = record->magic == CALIBRATION_MAGIC && record->version == CALIBRATION_VERSION &&
+               record->size == sizeof(calibration_record_t) && record->checksum == record_checksum(record);
+
+  for (int axis = 0; axis < CALIBRATION_NUM_AXES; axis++) {
+    if (valid) {
+      settings[axis] = record->axes[axis];
+      sanitise_settings(&settings[axis]);
+    } else {
+      default_settings(&settings[axis]);
+    }
+    build_table(axis);
+  }
+
+  mode = MODE_NORMAL;
+  learn_dirty = false;
+}
+
+void calibration_update(const joystick_state_t *state) {
+  uint32_t now_us = time_us_32();
+  uint16_t values[CALIBRATION_NUM_AXES];
+
+  read_axes(state, values);
+  run_calibration_mode(state, values, now_us);
+  if (mode == MODE_CALIBRATING) {
+    return;
+  }
+
+  // Nothing is learnt from an axis with no stick on it
+  for (int axis = 0; axis < CALIBRATION_NUM_AXES; axis++) {
+    if (state->axes_connected & 1u << axis) {
+      learn_dirty |= learn_extremes(&settings[axis], values[axis]);
+    }
+  }
+
+  if (learn_dirty && now_us - last_rebuild_us >= LEARN_REBUILD_INTERVAL_US) {
+    learn_dirty = false;
+    last_rebuild_us = now_us;
+    for (int axis = 0; axis < CALIBRATION_NUM_AXES; axis++) {
+      build_table(axis);
+    }
+  }
+}
+
+bool calibration_in_progress(void) {
+  return mode == MODE_WAIT_RELEASE || mode == MODE_CALIBRATING;
+}
+
+int16_t calibration_apply(uint8_t axis, uint16_t value) {
+  PROFILE_SCOPE(PROFILE_CALIBRATION_APPLY);
+  const int16_t *table = tables[axis];
+  uint32_t index = value >> TABLE_SHIFT;
+  int32_t fraction = value & ((1 << TABLE_SHIFT) - 1);
+
+  int32_t lower = table[index];
+  int32_t upper = table[index + 1];
+  return (int16_t)(lower + (((upper - lower) * fraction) >> TABLE_SHIFT));
+}
+
+void calibration_get(uint8_t axis, calibration_axis_t *axis_settings) {
+  *axis_settings = settings[axis];
+}
+
+void calibration_set(uint8_t axis, const calibration_axis_t *axis_settings) {
+  settings[axis] = *axis_settings;
+  sanitise_settings(&settings[axis]);
+  build_table(axis);
+}
+
+void calibration_save(void) {
+  // Flash can only be programmed in whole pages
+  static uint8_t page[FLASH_PAGE_SIZE];
+  _Static_assert(sizeof(calibration_record_t) <= FLASH_PAGE_SIZE, "Calibration record must fit in one flash page");
+
+  calibration_record_t record;
+  memset(&record, 0, sizeof(record));
+  record.magic = CALIBRATION_MAGIC;
+  record.version = CALIBRATION_VERSION;
+  record.size = sizeof(record);
+  memcpy(record.axes, settings, sizeof(settings));
+  record.checksum = record_checksum(&record);
+
+  memset(page, 0xFF, sizeof(page));
+  memcpy(page, &record, sizeof(record));
+
+  // Nothing may run from flash while it is being written, including core 1.
+  // This stalls USB for the length of the sector erase, which is acceptable
+  // at the end of calibration. The acquisition interrupts cannot run for that
+  // long either, so the ADC is stopped first rather than left to overflow.
+  joystick_pause_acquisition();
+#if JOYSTICK_CORE1
+  multicore_lockout_start_blocking();
+#endif
+  uint32_t interrupt_status = save_and_disable_interrupts();
+  flash_range_erase(CALIBRATION_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+  flash_range_program(CALIBRATION_FLASH_OFFSET, page, FLASH_PAGE_SIZE);
+  restore_interrupts(interrupt_status);
+#if JOYSTICK_CORE1
+  multicore_lockout_end_blocking();
+#endif
+  joystick_resume_acquisition();
+}
@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------
+// Per-axis joystick calibration, stored in flash and applied by table lookup
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __CALIBRATION_H__
+#define __CALIBRATION_H__
+
+#include "joystick.h"
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+#define CALIBRATION_NUM_AXES JOYSTICK_NUM_AXES
+#define CALIBRATION_AXIS_X 0
+#define CALIBRATION_AXIS_Y 1
+#define CALIBRATION_AXIS_X2 2  // Only with JOYSTICK_NUM_AXES > 2
+#define CALIBRATION_AXIS_Y2 3
+
+// Calibrated axis output range, symmetric about zero
+#define CALIBRATION_OUTPUT_MAX 32767
+
+// Hold both buttons this long to enter calibration mode. Then move the stick
+// to all of its extremes, let it return to centre, and press button 1 to save
+// or button 2 to cancel.
+#define CALIBRATION_COMBO_HOLD_MS 3000
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+typedef struct {
+  uint16_t min;                // Axis value at one end of travel
+  uint16_t centre;             // Axis value with the stick at rest
+  uint16_t max;                // Axis value at the other end of travel
+  uint16_t deadzone_permille;  // Fraction of each half of travel around the centre that reads as zero
+  uint16_t curve_percent;      // Blend from a linear (0) to a cubic (100) response
+} calibration_axis_t;
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+// Load the stored calibration from flash, or defaults if there is none, and
+// build the response tables
+void calibration_init(void);
+
+// Track the latest joystick state, learning new extremes and running the
+// button-combo calibration mode. Call from the USB task.
+void calibration_update(const joystick_state_t *state);
+
+// True while calibration mode is running
+bool calibration_in_progress(void);
+
+// Map an axis value through the axis' response table
+int16_t calibration_apply(uint8_t axis, uint16_t value);
+
+// Read or replace an axis' settings. Setting rebuilds its response table,
+// but does not save to flash.
+void calibration_get(uint8_t axis, calibration_axis_t *settings);
+void calibration_set(uint8_t axis, const calibration_axis_t *settings);
+
+// Write the current settings of all axes to flash
+void calibration_save(void);
+
+#endif  // __CALIBRATION_H__
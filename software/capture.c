@@ -0,0 +1,208 @@
+//-----------------------------------------------------------------------------
+// Flight recorder for raw ADC codes and button edges, for replay on a host
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "capture.h"
+
+#include <string.h>
+
+#include "calibration.h"
+#include "hardware/sync.h"
+#include "joystick.h"
+#include "pico/time.h"
+#include "usb_hid.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define CAPTURE_INDEX_MASK (CAPTURE_BUFFER_RECORDS - 1)
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+_Static_assert((CAPTURE_BUFFER_RECORDS & CAPTURE_INDEX_MASK) == 0, "CAPTURE_BUFFER_RECORDS must be a power of two");
+_Static_assert(CALIBRATION_NUM_AXES <= CAPTURE_MAX_AXES, "capture_settings_t has no room for every axis");
+
+static const filter_config_t built_in_filter = FILTER_CONFIG(JOYSTICK_FILTER_STAGES);
+
+#if JOYSTICK_CAPTURE && (JOYSTICK_ADC_DMA || JOYSTICK_AXIS_PIO)
+#error "Capture records raw codes from adc_irq, so needs the interrupt-driven ADC path"
+#endif
+
+#if JOYSTICK_CAPTURE && JOYSTICK_BUTTON_PIO
+#error "Capture records raw button edges, so needs the GPIO interrupt button path"
+#endif
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+#if JOYSTICK_CAPTURE
+static capture_record_t records[CAPTURE_BUFFER_RECORDS];
+static volatile uint32_t head = 0;    // Total records written
+static volatile bool paused = false;  // Set while dumping
+
+// Button levels as of the oldest record still held, so a replay starts with
+// the buttons the right way round
+static uint8_t oldest_buttons = 0;
+
+// Settings as of the oldest record, or near enough once the buffer has
+// wrapped, as the extremes learned since then are not undone
+static capture_settings_t start_settings;
+#endif
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static uint32_t fnv_add(uint32_t hash, uint32_t value) {
+  for (int byte = 0; byte < 4; byte++) {
+    hash = (hash ^ ((value >> (byte * 8)) & 0xFF)) * FNV_PRIME;
+  }
+  return hash;
+}
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+#if JOYSTICK_CAPTURE
+void capture_record(capture_type_t type, uint8_t channel, uint16_t value, uint32_t timestamp_us) {
+  if (paused) {
+    return;
+  }
+
+  capture_record_t *record = &records[head & CAPTURE_INDEX_MASK];
+
+  // An edge about to be overwritten becomes part of the starting state
+  if (head >= CAPTURE_BUFFER_RECORDS && record->type == CAPTURE_BUTTON) {
+    oldest_buttons = record->value ? oldest_buttons | 1 << record->channel : oldest_buttons & ~(1 << record->channel);
+  }
+
+  record->timestamp_us = timestamp_us;
+  record->value = value;
+  record->type = type;
+  record->channel = channel;
+  head++;
+}
+
+void capture_dump(capture_write_t write, void *context) {
+  paused = true;
+  __dmb();
+
+  uint32_t end = head;
+#if JOYSTICK_CORE1
+  // An interrupt on core 1 may still be finishing the newest record
+  if (end) {
+    end--;
+  }
+#endif
+
+  // Leave out the oldest slot too, in case a late record wraps onto it
+  uint32_t start = 0;
+  uint8_t buttons = oldest_buttons;
+  if (end >= CAPTURE_BUFFER_RECORDS) {
+    start = end - CAPTURE_BUFFER_RECORDS + 1;
+
+    const capture_record_t *skipped = &records[(start - 1) & CAPTURE_INDEX_MASK];
+    if (skipped->type == CAPTURE_BUTTON) {
+      buttons = skipped->value ? buttons | 1 << skipped->channel : buttons & ~(1 << skipped->channel);
+    }
+  }
+  uint32_t first_us = start != end ? records[start & CAPTURE_INDEX_MASK].timestamp_us : 0;
+
+  capture_header_t header = {
+      CAPTURE_MAGIC,
+      CAPTURE_VERSION,
+      sizeof(capture_record_t),
+      capture_flags(),
+      JOYSTICK_NUM_BUTTONS + end - start,
+      time_us_32(),
+      capture_filter_id(),
+      start_settings,
+  };
+  write(&header, sizeof(header), context);
+
+  // Starting button levels, as edges at the time of the first record
+  for (uint8_t button = 0; button < JOYSTICK_NUM_BUTTONS; button++) {
+    capture_record_t record = {first_us, (buttons >> button) & 1, CAPTURE_BUTTON, button};
+    write(&record, sizeof(record), context);
+  }
+
+  for (uint32_t i = start; i != end; i++) {
+    write(&records[i & CAPTURE_INDEX_MASK], sizeof(capture_record_t), context);
+  }
+
+  paused = false;
+}
+
+void capture_reset(void) {
+  joystick_state_t state;
+  joystick_read(&state);
+
+  paused = true;
+  __dmb();
+  head = 0;
+  oldest_buttons = (state.button_1 ? 1 << 0 : 0) | (state.button_2 ? 1 << 1 : 0);
+#if JOYSTICK_NUM_BUTTONS > 2
+  oldest_buttons |= (state.button_3 ? 1 << 2 : 0) | (state.button_4 ? 1 << 3 : 0);
+#endif
+  capture_read_settings(&start_settings);
+  __dmb();
+  paused = false;
+}
+#else
+void capture_dump(capture_write_t write, void *context) {}
+void capture_reset(void) {}
+#endif
+
+uint32_t capture_flags(void) {
+  return (JOYSTICK_ADC_DMA ? CAPTURE_FLAG_ADC_DMA : 0) | (JOYSTICK_CORE1 ? CAPTURE_FLAG_CORE1 : 0) |
+         (USB_HID_FAST_POLL ? CAPTURE_FLAG_FAST_POLL : 0) | (USB_HID_16BIT_AXES ? CAPTURE_FLAG_16BIT_AXES : 0) |
+         (JOYSTICK_SOF_SYNC ? CAPTURE_FLAG_SOF_SYNC : 0) | (JOYSTICK_BUTTON_PIO ? CAPTURE_FLAG_BUTTON_PIO : 0);
+}
+
+uint32_t capture_filter_id(void) {
+  uint32_t hash = fnv_add(FNV_OFFSET_BASIS, built_in_filter.num_stages);
+
+  for (uint8_t i = 0; i < built_in_filter.num_stages; i++) {
+    const filter_stage_config_t *stage = &built_in_filter.stages[i];
+    hash = fnv_add(hash, stage->type);
+    switch (stage->type) {
+      case FILTER_BOXCAR:
+      case FILTER_MEDIAN:
+        hash = fnv_add(hash, stage->window);
+        break;
+      case FILTER_IIR:
+        hash = fnv_add(hash, stage->shift);
+        break;
+      case FILTER_ONE_EURO:
+        hash = fnv_add(hash, stage->one_euro.min_cutoff_mhz);
+        hash = fnv_add(hash, stage->one_euro.beta_mhz);
+        hash = fnv_add(hash, stage->one_euro.d_cutoff_mhz);
+        break;
+    }
+  }
+  return hash;
+}
+
+void capture_read_settings(capture_settings_t *settings) {
+  hid_config_report_t config;
+  usb_hid_get_feature(USB_HID_REPORT_ID_CONFIG, (uint8_t *)&config, sizeof(config));
+
+  memset(settings, 0, sizeof(*settings));
+  settings->report_interval_ms = config.report_interval_ms;
+  settings->filter_window = config.filter_window;
+  settings->adc_clock_div = config.adc_clock_div;
+  settings->deadzone_permille = config.deadzone_permille;
+
+  for (uint8_t axis = 0; axis < CALIBRATION_NUM_AXES; axis++) {
+    calibration_axis_t axis_settings;
+    calibration_get(axis, &axis_settings);
+    settings->calibration[axis] = (capture_calibration_t){axis_settings.min, axis_settings.centre, axis_settings.max,
+                                                          axis_settings.deadzone_permille, axis_settings.curve_percent};
+  }
+}
@@ -0,0 +1,127 @@
+//-----------------------------------------------------------------------------
+// Flight recorder for raw ADC codes and button edges, for replay on a host
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+// Set to 1 to keep the most recent inputs in RAM, ready to be dumped
+#ifndef JOYSTICK_CAPTURE
+#define JOYSTICK_CAPTURE 0
+#endif
+
+// Records kept, 8 bytes each. With a conversion every
+// JOYSTICK_ADC_SAMPLE_PERIOD_NS, about 1.37 ms by default, this covers about
+// 11.2 s.
+#ifndef CAPTURE_BUFFER_RECORDS
+#define CAPTURE_BUFFER_RECORDS 8192  // Must be a power of two
+#endif
+
+#define CAPTURE_MAGIC 0x5041434A  // "JCAP"
+#define CAPTURE_VERSION 2
+
+// Axes with room for their calibration in capture_settings_t
+#define CAPTURE_MAX_AXES 4
+
+// Build options that change how a capture replays, in capture_header_t.flags
+#define CAPTURE_FLAG_ADC_DMA (1 << 0)
+#define CAPTURE_FLAG_CORE1 (1 << 1)
+#define CAPTURE_FLAG_FAST_POLL (1 << 2)
+#define CAPTURE_FLAG_16BIT_AXES (1 << 3)
+#define CAPTURE_FLAG_SOF_SYNC (1 << 4)
+#define CAPTURE_FLAG_BUTTON_PIO (1 << 5)
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+typedef enum {
+  CAPTURE_ADC,     // Raw 12-bit ADC code, channel is the axis
+  CAPTURE_BUTTON,  // Button edge, channel is the button, value is 1 when pressed
+} capture_type_t;
+
+// As calibration_axis_t
+typedef struct __attribute__((packed)) {
+  uint16_t min;
+  uint16_t centre;
+  uint16_t max;
+  uint16_t deadzone_permille;
+  uint16_t curve_percent;
+} capture_calibration_t;
+
+// Runtime settings in force when recording started, which a replay applies
+// before its first record. The config fields are as hid_config_report_t.
+typedef struct __attribute__((packed)) {
+  uint16_t report_interval_ms;
+  uint16_t filter_window;
+  uint16_t adc_clock_div;
+  uint16_t deadzone_permille;
+  capture_calibration_t calibration[CAPTURE_MAX_AXES];  // Zero past JOYSTICK_NUM_AXES
+} capture_settings_t;
+
+// A capture is a header followed by record_count records, all little-endian
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t flags;
+  uint32_t record_count;
+  uint32_t end_us;     // When the capture was dumped
+  uint32_t filter_id;  // Hash of JOYSTICK_FILTER_STAGES, see capture_filter_id()
+  capture_settings_t settings;
+} capture_header_t;
+
+typedef struct __attribute__((packed)) {
+  uint32_t timestamp_us;
+  uint16_t value;
+  uint8_t type;
+  uint8_t channel;
+} capture_record_t;
+
+_Static_assert(sizeof(capture_header_t) == 72, "Capture header layout is part of the file format");
+_Static_assert(sizeof(capture_record_t) == 8, "Capture record layout is part of the file format");
+
+// Receives the capture, a chunk at a time
+typedef void (*capture_write_t)(const void *data, uint32_t len, void *context);
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+#if JOYSTICK_CAPTURE
+// Add a record, overwriting the oldest once the buffer is full. Must only be
+// called from the acquisition interrupts.
+void capture_record(capture_type_t type, uint8_t channel, uint16_t value, uint32_t timestamp_us);
+#else
+static inline void capture_record(capture_type_t type, uint8_t channel, uint16_t value, uint32_t timestamp_us) {}
+#endif
+
+// Write out everything recorded so far, oldest first. Recording pauses while
+// this runs.
+void capture_dump(capture_write_t write, void *context);
+
+// Forget everything recorded so far, and start again from the settings now
+// in force. Call from the USB task whenever the settings are changed other
+// than by the inputs being recorded.
+void capture_reset(void);
+
+// Flags for this build, for capture_header_t.flags
+uint32_t capture_flags(void);
+
+// Identifies the filter stages built in, for capture_header_t.filter_id
+uint32_t capture_filter_id(void);
+
+// The runtime settings now in force, for capture_header_t.settings. Call from
+// the USB task.
+void capture_read_settings(capture_settings_t *settings);
+
+#endif  // __CAPTURE_H__
@@ -0,0 +1,144 @@
+//-----------------------------------------------------------------------------
+// Deferred binary logging over the debug UART
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "debug_log.h"
+
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/uart.h"
+#include "pico/platform.h"
+#include "pico/time.h"
+#include "scheduler.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define RING_INDEX_MASK (DEBUG_LOG_RING_SIZE - 1)
+#define RECORD_HEADER_BYTES 7
+
+_Static_assert((DEBUG_LOG_RING_SIZE & RING_INDEX_MASK) == 0, "DEBUG_LOG_RING_SIZE must be a power of two");
+_Static_assert(DEBUG_LOG_NUM_FORMATS <= 256, "Format IDs are sent as a single byte");
+
+// Same UART as stdio
+#define LOG_UART uart_default
+#define LOG_UART_IRQ (PICO_DEFAULT_UART ? UART1_IRQ : UART0_IRQ)
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+// Single-producer, single-consumer byte ring, as for edge_queue_t
+static uint8_t ring[DEBUG_LOG_RING_SIZE];
+static volatile uint32_t head = 0;  // Written by the producer only
+static volatile uint32_t tail = 0;  // Written by the main loop only
+static uint32_t dropped = 0;        // Records dropped since the last one queued
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+// Runs once the UART has worked through the FIFO, to send the next part of
+// the ring from the main loop
+static void log_uart_irq(void) {
+  uart_set_irq_enables(LOG_UART, false, false);
+  scheduler_post(SCHEDULER_EVENT_DEBUG_LOG);
+}
+
+static inline void put_byte(uint32_t *index, uint8_t value) {
+  ring[*index & RING_INDEX_MASK] = value;
+  (*index)++;
+}
+
+static inline void put_word(uint32_t *index, uint32_t value) {
+  put_byte(index, value);
+  put_byte(index, value >> 8);
+  put_byte(index, value >> 16);
+  put_byte(index, value >> 24);
+}
+
+static bool queue_record(debug_log_format_t format, const uint32_t *args, uint32_t num_args) {
+  uint32_t index = head;
+  if (DEBUG_LOG_RING_SIZE - (index - tail) < RECORD_HEADER_BYTES + num_args * sizeof(uint32_t)) {
+    return false;
+  }
+
+  put_byte(&index, DEBUG_LOG_SYNC);
+  put_byte(&index, format);
+  put_byte(&index, num_args);
+  put_word(&index, time_us_32());
+  for (uint32_t i = 0; i < num_args; i++) {
+    put_word(&index, args[i]);
+  }
+
+  // Record contents must be visible before the main loop can see the new head
+  __dmb();
+  head = index;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+void debug_log_init(void) {
+  uart_set_irq_enables(LOG_UART, false, false);
+  irq_set_exclusive_handler(LOG_UART_IRQ, &log_uart_irq);
+  irq_set_enabled(LOG_UART_IRQ, true);
+}
+
+void debug_log_write(debug_log_format_t format, const uint32_t *args, uint32_t num_args) {
+  if (num_args > DEBUG_LOG_MAX_ARGS) {
+    num_args = DEBUG_LOG_MAX_ARGS;
+  }
+
+  // Say how much went missing as soon as there is room again
+  if (dropped) {
+    if (!queue_record(DEBUG_LOG_DROPPED, &dropped, 1)) {
+      dropped++;
+      return;
+    }
+    dropped = 0;
+  }
+
+  if (!queue_record(format, args, num_args)) {
+    dropped++;
+    return;
+  }
+  scheduler_post(SCHEDULER_EVENT_DEBUG_LOG);
+}
+
+void debug_log_task(void) {
+  uint32_t index = tail;
+  uint32_t end = head;
+  __dmb();
+
+  while (index != end && uart_is_writable(LOG_UART)) {
+    uart_get_hw(LOG_UART)->dr = ring[index & RING_INDEX_MASK];
+    index++;
+  }
+
+  // Only release the bytes once they are in the FIFO
+  __dmb();
+  tail = index;
+
+  // The FIFO is only full when there is more to send, and the UART
+  // interrupts as it empties
+  if (index != end) {
+    uart_set_irq_enables(LOG_UART, false, true);
+  }
+}
+
+void debug_log_flush(void) {
+  while (tail != head) {
+    // On core 0 this is the main loop, so drain directly. Otherwise wait for
+    // the main loop to do it.
+    if (get_core_num() == 0) {
+      debug_log_task();
+    }
+    tight_loop_contents();
+  }
+}
@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+// Deferred binary logging over the debug UART. Call sites store a format ID
+// and raw arguments in a RAM ring, the main loop drains it to the UART
+// without blocking, and tools/debug_log_decode.py does the formatting.
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __DEBUG_LOG_H__
+#define __DEBUG_LOG_H__
+
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+#define DEBUG_LOG_RING_SIZE 2048  // Bytes, must be a power of two
+#define DEBUG_LOG_MAX_ARGS 8
+
+// Each record is DEBUG_LOG_SYNC, the format ID, the argument count, a
+// 32-bit timestamp in microseconds and then the arguments, all little-endian.
+// The sync byte is never valid ASCII, so records can share the UART with
+// plain text.
+#define DEBUG_LOG_SYNC 0xA5
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+typedef enum {
+#define DEBUG_LOG_FORMAT(name, format) DEBUG_LOG_##name,
+#include "debug_log_formats.h"
+#undef DEBUG_LOG_FORMAT
+  DEBUG_LOG_NUM_FORMATS
+} debug_log_format_t;
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+// Set up the UART drain. Call from core 0 before anything is logged.
+void debug_log_init(void);
+
+// Queue a record, or count it as dropped if the ring is full. Takes well
+// under a microsecond and never blocks. Records must all come from one
+// context at a time, on either core.
+void debug_log_write(debug_log_format_t format, const uint32_t *args, uint32_t num_args);
+
+// Log a message from debug_log_formats.h, with up to DEBUG_LOG_MAX_ARGS
+// arguments
+#define DEBUG_LOG(name, ...)                                                                  \
+  do {                                                                                        \
+    const uint32_t debug_log_args[] = {0, ##__VA_ARGS__};                                     \
+    debug_log_write(DEBUG_LOG_##name, debug_log_args + 1, sizeof(debug_log_args) / sizeof(uint32_t) - 1); \
+  } while (0)
+
+// Pass a float to a %f argument
+static inline uint32_t debug_log_float(float value) {
+  union {
+    float f;
+    uint32_t u;
+  } bits = {.f = value};
+  return bits.u;
+}
+
+// Pass a string constant to a %s argument. The string itself is not sent.
+static inline uint32_t debug_log_string(const char *string) {
+  return (uint32_t)(uintptr_t)string;
+}
+
+// Send as much of the ring as the UART FIFO will take. Call from the main
+// loop on core 0 on SCHEDULER_EVENT_DEBUG_LOG.
+void debug_log_task(void);
+
+// Wait until everything logged so far has gone out, before writing plain
+// text to the UART directly
+void debug_log_flush(void);
+
+#endif  // __DEBUG_LOG_H__
@@ -0,0 +1,25 @@
+//-----------------------------------------------------------------------------
+// Every debug log message, as DEBUG_LOG_FORMAT(name, format). The position
+// in this list is the format ID sent over the UART, and
+// tools/debug_log_decode.py reads this file to format the records, so only
+// ever append to it.
+//
+// Each argument is sent as 32 bits: %d is signed, %u and %x unsigned, %f a
+// float passed through debug_log_float(), and %s a pointer to a string
+// constant, looked up in the firmware ELF file by the decoder.
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+DEBUG_LOG_FORMAT(DROPPED, "(%u debug log records dropped)")
+DEBUG_LOG_FORMAT(BANNER, "Raspberry Pi Pico gameport joystick USB adapter")
+DEBUG_LOG_FORMAT(COPYRIGHT, "Copyright 2023 Alan Reed (areed.me)")
+DEBUG_LOG_FORMAT(RAW_AXES, "Raw joystick values: X: %f Y: %f B1: %d B2: %d")
+DEBUG_LOG_FORMAT(EXTRA_BUTTONS, "B3: %d B4: %d")
+DEBUG_LOG_FORMAT(CALIBRATED_AXES, "Calibrated joystick axes: X: %d Y: %d%s")
+DEBUG_LOG_FORMAT(SECOND_STICK, "Second stick: X: %f Y: %f, calibrated X: %d Y: %d")
+DEBUG_LOG_FORMAT(SCHEDULER_STATS, "Core 0: %u.%u%% busy, %u wake-ups/s")
+DEBUG_LOG_FORMAT(LATENCY, "Latency %s: n: %u min: %u mean: %u max: %u us")
+DEBUG_LOG_FORMAT(PROFILE, "Profile %s: n: %u min: %u mean: %u max: %u cycles (%u us max)")
+DEBUG_LOG_FORMAT(FIRST_REPORT, "First report %u us after reset")
+DEBUG_LOG_FORMAT(LATENCY_BUCKET, "  %6u+ us: %u")
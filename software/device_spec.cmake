@@ -0,0 +1,34 @@
+#-----------------------------------------------------------------------------
+# Build-time generation of the USB descriptors and HID report code from
+# device_spec.json
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+set(DEVICE_SPEC ${CMAKE_CURRENT_LIST_DIR}/device_spec.json)
+set(DEVICE_SPEC_GENERATOR ${CMAKE_CURRENT_LIST_DIR}/tools/gen_device_spec.py)
+
+set(DEVICE_SPEC_OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/generated)
+
+add_custom_command(
+        OUTPUT ${DEVICE_SPEC_OUTPUT_DIR}/device_spec.c ${DEVICE_SPEC_OUTPUT_DIR}/device_spec.h
+               ${DEVICE_SPEC_OUTPUT_DIR}/device_spec_report.h
+        COMMAND Python3::Interpreter ${DEVICE_SPEC_GENERATOR}
+                --spec ${DEVICE_SPEC}
+                --output-dir ${DEVICE_SPEC_OUTPUT_DIR}
+        DEPENDS ${DEVICE_SPEC_GENERATOR} ${DEVICE_SPEC}
+        COMMENT "Generating USB device layout")
+
+# Generated once, however many targets use it. Every build option combination
+# listed in the spec is in the one header.
+add_custom_target(device_spec DEPENDS ${DEVICE_SPEC_OUTPUT_DIR}/device_spec.c ${DEVICE_SPEC_OUTPUT_DIR}/device_spec.h
+                                      ${DEVICE_SPEC_OUTPUT_DIR}/device_spec_report.h)
+
+# Add the generated device_spec.c/.h and device_spec_report.h to the given target
+function(joystick_add_device_spec target)
+  add_dependencies(${target} device_spec)
+  target_sources(${target} PRIVATE ${DEVICE_SPEC_OUTPUT_DIR}/device_spec.c)
+  target_include_directories(${target} PUBLIC ${DEVICE_SPEC_OUTPUT_DIR})
+endfunction()
@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+// Lock-free queue of timestamped button edges, from interrupt to USB task
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "edge_queue.h"
+
+#include "hardware/sync.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define EDGE_QUEUE_INDEX_MASK (EDGE_QUEUE_DEPTH - 1)
+
+_Static_assert((EDGE_QUEUE_DEPTH & EDGE_QUEUE_INDEX_MASK) == 0, "EDGE_QUEUE_DEPTH must be a power of two");
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+void edge_queue_init(edge_queue_t *queue) {
+  queue->head = 0;
+  queue->tail = 0;
+  queue->dropped = 0;
+}
+
+bool edge_queue_push(edge_queue_t *queue, const button_edge_t *edge) {
+  uint32_t head = queue->head;
+
+  if (head - queue->tail >= EDGE_QUEUE_DEPTH) {
+    queue->dropped++;
+    return false;
+  }
+
+  queue->slots[head & EDGE_QUEUE_INDEX_MASK] = *edge;
+
+  // Slot contents must be visible before the consumer can see the new head
+  __dmb();
+  queue->head = head + 1;
+  return true;
+}
+
+bool edge_queue_pop(edge_queue_t *queue, button_edge_t *edge) {
+  uint32_t tail = queue->tail;
+  if (queue->head == tail) {
+    return false;
+  }
+  __dmb();
+
+  *edge = queue->slots[tail & EDGE_QUEUE_INDEX_MASK];
+
+  // Only release the slot once the copy has completed
+  __dmb();
+  queue->tail = tail + 1;
+  return true;
+}
@@ -0,0 +1,51 @@
+//-----------------------------------------------------------------------------
+// Lock-free queue of timestamped button edges, from interrupt to USB task
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __EDGE_QUEUE_H__
+#define __EDGE_QUEUE_H__
+
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+#define EDGE_QUEUE_DEPTH 32  // Must be a power of two
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+typedef struct {
+  uint8_t button;         // Button index, from 0
+  bool pressed;           // Level after the edge
+  uint32_t timestamp_us;  // When the edge interrupt ran
+} button_edge_t;
+
+// Single-producer, single-consumer ring. The free-running head and tail only
+// ever move forward, and a barrier orders each slot against the index that
+// publishes or frees it, so neither side needs a lock.
+typedef struct {
+  volatile uint32_t head;     // Written by the producer only
+  volatile uint32_t tail;     // Written by the consumer only
+  volatile uint32_t dropped;  // Edges discarded because the ring was full
+  button_edge_t slots[EDGE_QUEUE_DEPTH];
+} edge_queue_t;
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+void edge_queue_init(edge_queue_t *queue);
+
+// Producer side: queue an edge, returning false if the ring is full
+bool edge_queue_push(edge_queue_t *queue, const button_edge_t *edge);
+
+// Consumer side: take the oldest edge, returning false if there is none
+bool edge_queue_pop(edge_queue_t *queue, button_edge_t *edge);
+
+#endif  // __EDGE_QUEUE_H__
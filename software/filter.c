@@ -0,0 +1,197 @@
+//-----------------------------------------------------------------------------
+// Chain of per-axis filter stages: moving average, median, IIR and One-Euro
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "filter.h"
+
+#include <string.h>
+
+#include "joystick.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define FRACTION_BITS 8  // Fractional bits kept in IIR and One-Euro state
+
+// 2 * pi in 16.16 fixed point
+#define TWO_PI_Q16 411775
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static uint16_t clamp_axis(int32_t value) {
+  if (value < 0) {
+    return 0;
+  }
+  if (value > JOYSTICK_AXIS_FULL_SCALE) {
+    return JOYSTICK_AXIS_FULL_SCALE;
+  }
+  return (uint16_t)value;
+}
+
+static uint16_t median_process(filter_stage_t *stage, uint16_t value) {
+  uint16_t window = stage->config.window;
+  uint16_t sorted[FILTER_MEDIAN_MAX_WINDOW];
+
+  // Ring of the last window samples, oldest overwritten first
+  uint8_t index = stage->state.median.index;
+  stage->state.median.values[index] = value;
+  index++;
+  stage->state.median.index = (index == window) ? 0 : index;
+  if (stage->state.median.count < window) {
+    stage->state.median.count++;
+  }
+
+  // Insertion sort, as there are never more than a handful of values
+  uint8_t count = stage->state.median.count;
+  for (uint8_t i = 0; i < count; i++) {
+    uint16_t v = stage->state.median.values[i];
+    int8_t j = i - 1;
+    while (j >= 0 && sorted[j] > v) {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = v;
+  }
+
+  return sorted[count / 2];
+}
+
+static uint16_t iir_process(filter_stage_t *stage, uint16_t value) {
+  int32_t input = (int32_t)value << FRACTION_BITS;
+
+  if (!stage->primed) {
+    stage->state.iir = input;
+  }
+  stage->state.iir += (input - stage->state.iir) >> stage->config.shift;
+
+  return clamp_axis((stage->state.iir + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+}
+
+// Smoothing factor, in 16.16 fixed point, of a single-pole low pass with the
+// given cutoff over the given sample interval
+static int32_t one_euro_alpha(uint32_t cutoff_mhz, uint32_t dt_us) {
+  // alpha = w / (1 + w), w = 2 pi fc dt
+  uint64_t w = (uint64_t)cutoff_mhz * dt_us * TWO_PI_Q16 / 1000000000u;
+  return (int32_t)((w << 16) / ((1 << 16) + w));
+}
+
+static uint16_t one_euro_process(filter_stage_t *stage, uint16_t value, uint32_t timestamp_us) {
+  int32_t input = (int32_t)value << FRACTION_BITS;
+
+  if (!stage->primed) {
+    stage->state.one_euro.value = input;
+    stage->state.one_euro.speed = 0;
+    stage->state.one_euro.last_us = timestamp_us;
+    return value;
+  }
+
+  uint32_t dt_us = timestamp_us - stage->state.one_euro.last_us;
+  if (dt_us == 0) {
+    dt_us = 1;
+  }
+  stage->state.one_euro.last_us = timestamp_us;
+
+  // Smoothed speed, which sets the cutoff for the value itself
+  int32_t delta = input - stage->state.one_euro.value;
+  int64_t raw_speed = ((int64_t)delta * 1000000 / dt_us) >> FRACTION_BITS;
+  int32_t speed = raw_speed > INT32_MAX / 2 ? INT32_MAX / 2 : raw_speed < -INT32_MAX / 2 ? -INT32_MAX / 2 : (int32_t)raw_speed;
+  int32_t alpha = one_euro_alpha(stage->config.one_euro.d_cutoff_mhz, dt_us);
+  stage->state.one_euro.speed += (int32_t)(((int64_t)(speed - stage->state.one_euro.speed) * alpha) >> 16);
+
+  uint32_t abs_speed = stage->state.one_euro.speed < 0 ? -stage->state.one_euro.speed : stage->state.one_euro.speed;
+  uint64_t cutoff_mhz = stage->config.one_euro.min_cutoff_mhz +
+                        (uint64_t)stage->config.one_euro.beta_mhz * abs_speed / (JOYSTICK_AXIS_FULL_SCALE + 1);
+  if (cutoff_mhz > UINT32_MAX) {
+    cutoff_mhz = UINT32_MAX;
+  }
+
+  alpha = one_euro_alpha((uint32_t)cutoff_mhz, dt_us);
+  stage->state.one_euro.value += (int32_t)(((int64_t)delta * alpha) >> 16);
+
+  return clamp_axis((stage->state.one_euro.value + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+}
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+void filter_chain_init(filter_chain_t *chain, const filter_config_t *config) {
+  memset(chain, 0, sizeof(*chain));
+  chain->num_stages = config->num_stages > FILTER_MAX_STAGES ? FILTER_MAX_STAGES : config->num_stages;
+
+  for (uint8_t i = 0; i < chain->num_stages; i++) {
+    filter_stage_t *stage = &chain->stages[i];
+    stage->config = config->stages[i];
+
+    switch (stage->config.type) {
+      case FILTER_BOXCAR:
+        buffer_init(&stage->state.boxcar, stage->config.window);
+        break;
+      case FILTER_MEDIAN:
+        if (stage->config.window < 1) {
+          stage->config.window = 1;
+        } else if (stage->config.window > FILTER_MEDIAN_MAX_WINDOW) {
+          stage->config.window = FILTER_MEDIAN_MAX_WINDOW;
+        }
+        break;
+      case FILTER_IIR:
+        if (stage->config.shift > 15) {
+          stage->config.shift = 15;
+        }
+        break;
+      case FILTER_ONE_EURO:
+        break;
+    }
+  }
+}
+
+void filter_chain_seed(filter_chain_t *chain, uint16_t value) {
+  for (uint8_t i = 0; i < chain->num_stages; i++) {
+    filter_stage_t *stage = &chain->stages[i];
+
+    // The other stages take their first value as it comes once unprimed
+    switch (stage->config.type) {
+      case FILTER_BOXCAR:
+        buffer_fill(&stage->state.boxcar, value);
+        break;
+      case FILTER_MEDIAN:
+        stage->state.median.index = 0;
+        stage->state.median.count = 0;
+        break;
+      case FILTER_IIR:
+      case FILTER_ONE_EURO:
+        break;
+    }
+    stage->primed = false;
+  }
+}
+
+uint16_t filter_chain_process(filter_chain_t *chain, uint16_t value, uint32_t timestamp_us) {
+  for (uint8_t i = 0; i < chain->num_stages; i++) {
+    filter_stage_t *stage = &chain->stages[i];
+
+    switch (stage->config.type) {
+      case FILTER_BOXCAR:
+        buffer_write(&stage->state.boxcar, value);
+        value = buffer_average(&stage->state.boxcar);
+        break;
+      case FILTER_MEDIAN:
+        value = median_process(stage, value);
+        break;
+      case FILTER_IIR:
+        value = iir_process(stage, value);
+        break;
+      case FILTER_ONE_EURO:
+        value = one_euro_process(stage, value, timestamp_us);
+        break;
+    }
+    stage->primed = true;
+  }
+
+  return value;
+}
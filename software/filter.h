@@ -0,0 +1,100 @@
+//-----------------------------------------------------------------------------
+// Chain of per-axis filter stages: moving average, median, IIR and One-Euro
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+#include "buffer.h"
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+#define FILTER_MAX_STAGES 4
+#define FILTER_MEDIAN_MAX_WINDOW 5
+
+// Stage initialisers, for building a filter_config_t with FILTER_CONFIG()
+#define FILTER_STAGE_BOXCAR(samples) {.type = FILTER_BOXCAR, .window = (samples)}
+#define FILTER_STAGE_MEDIAN(samples) {.type = FILTER_MEDIAN, .window = (samples)}
+#define FILTER_STAGE_IIR(alpha_shift) {.type = FILTER_IIR, .shift = (alpha_shift)}
+#define FILTER_STAGE_ONE_EURO(min_cutoff_mhz, beta_mhz, d_cutoff_mhz) \
+  {.type = FILTER_ONE_EURO, .one_euro = {(min_cutoff_mhz), (beta_mhz), (d_cutoff_mhz)}}
+
+// Chain of the given stages, in the order samples pass through them
+#define FILTER_CONFIG(...)                                                            \
+  {sizeof((filter_stage_config_t[]){__VA_ARGS__}) / sizeof(filter_stage_config_t), \
+   {__VA_ARGS__}}
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+typedef enum {
+  FILTER_BOXCAR,    // Moving average of the last window samples
+  FILTER_MEDIAN,    // Median of the last window samples, for rejecting spikes
+  FILTER_IIR,       // Single-pole low pass, y += (x - y) / 2^shift
+  FILTER_ONE_EURO,  // Low pass with a cutoff that rises with the speed of the stick
+} filter_type_t;
+
+typedef struct {
+  filter_type_t type;
+  union {
+    uint16_t window;  // FILTER_BOXCAR, FILTER_MEDIAN
+    uint8_t shift;    // FILTER_IIR
+    struct {
+      uint32_t min_cutoff_mhz;  // Cutoff with the stick at rest
+      uint32_t beta_mhz;        // Cutoff added per full scale per second of stick speed
+      uint32_t d_cutoff_mhz;    // Cutoff for smoothing the speed estimate
+    } one_euro;                 // FILTER_ONE_EURO
+  };
+} filter_stage_config_t;
+
+typedef struct {
+  uint8_t num_stages;
+  filter_stage_config_t stages[FILTER_MAX_STAGES];
+} filter_config_t;
+
+typedef struct {
+  filter_stage_config_t config;
+  union {
+    buffer_t boxcar;
+    struct {
+      uint16_t values[FILTER_MEDIAN_MAX_WINDOW];
+      uint8_t index;
+      uint8_t count;
+    } median;
+    int32_t iir;  // Output with 8 fractional bits
+    struct {
+      int32_t value;  // Output with 8 fractional bits
+      int32_t speed;  // Smoothed speed, axis units per second
+      uint32_t last_us;
+    } one_euro;
+  } state;
+  bool primed;
+} filter_stage_t;
+
+typedef struct {
+  uint8_t num_stages;
+  filter_stage_t stages[FILTER_MAX_STAGES];
+} filter_chain_t;
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+// Set up a chain from the given stages, clearing any history
+void filter_chain_init(filter_chain_t *chain, const filter_config_t *config);
+
+// Drop the history of every stage, so the next value passes straight through
+// and the stages carry on from there, as if it were the only value so far
+void filter_chain_seed(filter_chain_t *chain, uint16_t value);
+
+// Pass a new axis value, taken at the given time, through every stage
+uint16_t filter_chain_process(filter_chain_t *chain, uint16_t value, uint32_t timestamp_us);
+
+#endif  // __FILTER_H__
@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------------------
+// Host benchmark for the age of the axis data in each HID report when the
+// host collects it, with a free-running ADC or sampling locked to the frame
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_hal.h"
+#include "joystick.h"
+#include "latency.h"
+#include "pico/time.h"
+#include "scheduler.h"
+#include "sof_sync.h"
+#include "usb_hid.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define SIMULATED_SECONDS 10
+#define MAIN_LOOP_PERIOD_US 5  // Simulated cost of one pass of the main loop
+#define WARM_UP_US 10000       // Left out, as the first report carries the burst that primed the filters
+#define ADC_MAX_CODE 4095
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+#if !JOYSTICK_SOF_SYNC
+static uint64_t sample_time_ns;
+static int sample_axis;
+#endif
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+// Circles fast enough to change every report
+static uint16_t stick_code(uint64_t time_us, int axis) {
+  double phase = 2 * M_PI * time_us / 500000.0;
+  double position = axis ? sin(phase) : cos(phase);
+
+  return (uint16_t)(ADC_MAX_CODE / 2 + position * 1500);
+}
+
+// Advance the simulated clock, delivering ADC conversions as they complete
+static void run_hardware_us(uint32_t us) {
+#if JOYSTICK_SOF_SYNC
+  // Each pair the firmware starts is converted straight away
+  if (host_adc_running()) {
+    host_adc_push(stick_code(time_us_64(), 0));
+    host_adc_push(stick_code(time_us_64(), 1));
+  }
+#else
+  sample_time_ns += (uint64_t)us * 1000;
+  while (sample_time_ns >= JOYSTICK_ADC_SAMPLE_PERIOD_NS) {
+    sample_time_ns -= JOYSTICK_ADC_SAMPLE_PERIOD_NS;
+    host_adc_push(stick_code(time_us_64(), sample_axis));
+    sample_axis ^= 1;
+  }
+#endif
+  host_advance_time_us(us);
+}
+
+//-----------------------------------------------------------------------------
+// Main entry point
+//-----------------------------------------------------------------------------
+
+int main(void) {
+  host_hal_reset();
+  host_set_hid_poll_interval_ms(USB_HID_POLL_INTERVAL_MS);
+  joystick_init();
+  usb_init();
+  sof_sync_init();
+
+  // As in main.c, the USB task only runs when an interrupt has posted work
+  uint64_t end_us = (uint64_t)SIMULATED_SECONDS * 1000000;
+  bool warmed_up = false;
+  while (time_us_64() < end_us) {
+    run_hardware_us(MAIN_LOOP_PERIOD_US);
+    if (scheduler_take() & (1u << SCHEDULER_EVENT_INPUT | 1u << SCHEDULER_EVENT_REPORT)) {
+      usb_task();
+    }
+    if (!warmed_up && time_us_64() >= WARM_UP_US) {
+      warmed_up = true;
+      latency_reset();
+    }
+  }
+
+  latency_histogram_t histogram;
+  latency_read(LATENCY_SAMPLE_TO_COMPLETE, &histogram);
+  if (!histogram.count) {
+    return EXIT_FAILURE;
+  }
+
+  printf("sample age when collected by the host (%s):\n",
+         JOYSTICK_SOF_SYNC ? "sampling locked to the frame" : "free-running ADC");
+  printf("  reports: %u min: %u mean: %.1f max: %u spread: %u us\n", histogram.count, histogram.min_us,
+         (double)histogram.total_us / histogram.count, histogram.max_us, histogram.max_us - histogram.min_us);
+
+  // Locked to the frame, every report must be collected in the frame after
+  // its sample
+  return !JOYSTICK_SOF_SYNC || histogram.max_us <= SOF_SYNC_LEAD_US + SOF_SYNC_FRAME_US / 10 ? EXIT_SUCCESS
+                                                                                          : EXIT_FAILURE;
+}
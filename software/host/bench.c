@@ -0,0 +1,143 @@
+//-----------------------------------------------------------------------------
+// Host benchmark for the ADC -> buffer -> joystick -> HID report pipeline
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "host_hal.h"
+#include "joystick.h"
+#include "usb_hid.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define DEFAULT_NUM_SAMPLES 4000000
+#define NUM_SYNTHETIC_SAMPLES 65536  // Power of two, so the index can be masked
+#define ADC_MAX_CODE 4095
+
+// Samples in one sweep up and down the ADC range. DMA averages each axis over
+// a 1024-sample block and then over several blocks, so there the sweep spans
+// the whole synthetic buffer, 64 blocks, rather than averaging out.
+#if JOYSTICK_ADC_DMA
+#define SWEEP_PERIOD_SAMPLES NUM_SYNTHETIC_SAMPLES
+#else
+#define SWEEP_PERIOD_SAMPLES 512
+#endif
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static uint16_t samples[NUM_SYNTHETIC_SAMPLES];
+static uint32_t report_checksum;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static uint64_t wall_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Slow sweep across the full ADC range with a little LCG noise on top,
+// so every code path through the conversion is exercised
+static void generate_samples(void) {
+  uint32_t lcg = 12345;
+
+  for (int i = 0; i < NUM_SYNTHETIC_SAMPLES; i++) {
+    lcg = lcg * 1664525u + 1013904223u;
+    int32_t sweep = (int32_t)((int64_t)(i % SWEEP_PERIOD_SAMPLES) * 2 * ADC_MAX_CODE / SWEEP_PERIOD_SAMPLES);
+    if (sweep > ADC_MAX_CODE) {
+      sweep = 2 * ADC_MAX_CODE - sweep;
+    }
+
+    int32_t value = sweep + (int32_t)(lcg >> 29) - 4;
+    if (value < 1) {
+      value = 1;
+    } else if (value > ADC_MAX_CODE) {
+      value = ADC_MAX_CODE;
+    }
+    samples[i] = (uint16_t)value;
+  }
+}
+
+static void report_hook(uint64_t time_us, const void *report, uint16_t len) {
+  const uint8_t *bytes = report;
+  for (uint16_t i = 0; i < len; i++) {
+    report_checksum = report_checksum * 31 + bytes[i];
+  }
+}
+
+static void setup(void) {
+  host_hal_reset();
+  host_set_hid_report_hook(&report_hook);
+  host_set_hid_poll_interval_ms(USB_HID_POLL_INTERVAL_MS);
+  joystick_init();
+  usb_init();
+}
+
+//-----------------------------------------------------------------------------
+// Main entry point
+//-----------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+  uint32_t num_samples = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_NUM_SAMPLES;
+  uint32_t num_reports = num_samples / 16;
+
+  generate_samples();
+
+  // Acquisition only: adc_irq -> buffer_write
+  setup();
+  uint64_t start = wall_ns();
+  for (uint32_t i = 0; i < num_samples; i++) {
+    host_adc_push(samples[i & (NUM_SYNTHETIC_SAMPLES - 1)]);
+  }
+  uint64_t acquisition_ns = wall_ns() - start;
+
+  // Report only: joystick_read -> usb_task -> tud_hid_report, with a fresh
+  // sample every poll interval so that report-on-change has something to send
+  start = wall_ns();
+  for (uint32_t i = 0; i < num_reports; i++) {
+    for (int axis = 0; axis < 2; axis++) {
+      host_adc_push(samples[(i * 2 + axis) & (NUM_SYNTHETIC_SAMPLES - 1)]);
+    }
+    host_advance_time_us(USB_HID_POLL_INTERVAL_MS * 1000);
+    usb_task();
+  }
+  uint64_t report_ns = wall_ns() - start;
+  uint32_t reports_sent = host_hid_report_count();
+
+  // Full pipeline at the firmware's ADC rate, with the main loop polling
+  // usb_task() after every sample
+  setup();
+  uint64_t sample_time_ns = 0;
+  start = wall_ns();
+  for (uint32_t i = 0; i < num_samples; i++) {
+    host_adc_push(samples[i & (NUM_SYNTHETIC_SAMPLES - 1)]);
+
+    sample_time_ns += JOYSTICK_ADC_SAMPLE_PERIOD_NS;
+    if (sample_time_ns >= 1000) {
+      host_advance_time_us(sample_time_ns / 1000);
+      sample_time_ns %= 1000;
+    }
+    usb_task();
+  }
+  uint64_t pipeline_ns = wall_ns() - start;
+
+  printf("acquisition: %10u samples %8.2f ns/sample\n",
+         num_samples, (double)acquisition_ns / num_samples);
+  printf("report:      %10u polls   %8.2f ns/poll   %12.0f reports/s (%u sent)\n",
+         num_reports, (double)report_ns / num_reports, reports_sent * 1e9 / report_ns, reports_sent);
+  printf("pipeline:    %10u samples %8.2f ns/sample %10u reports\n",
+         num_samples, (double)pipeline_ns / num_samples, host_hid_report_count());
+  printf("checksum:    %08x\n", report_checksum);
+
+  return reports_sent > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
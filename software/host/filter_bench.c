@@ -0,0 +1,149 @@
+//-----------------------------------------------------------------------------
+// Host benchmark for axis filter chains: step-response latency against
+// residual jitter and spike rejection on a noisy stick
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "filter.h"
+#include "joystick.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+// One new value per axis every X, Y pair of conversions
+#define SAMPLE_PERIOD_US (2 * JOYSTICK_ADC_SAMPLE_PERIOD_NS / 1000)
+
+#define STEP_LOW (JOYSTICK_AXIS_FULL_SCALE / 4)
+#define STEP_HIGH (3 * JOYSTICK_AXIS_FULL_SCALE / 4)
+#define SETTLE_SAMPLES 2000   // Run before the step, so every stage is primed
+#define STEP_SAMPLES 2000     // Run after the step, to find the response times
+#define NOISE_SAMPLES 100000  // Steady stick with noise, for jitter
+
+// Worn track: a little wiper noise, plus the occasional large spike where the
+// wiper briefly loses contact
+#define NOISE_AMPLITUDE 96
+#define SPIKE_INTERVAL 500
+#define SPIKE_AMPLITUDE 12000
+
+//-----------------------------------------------------------------------------
+// Private types
+//-----------------------------------------------------------------------------
+
+typedef struct {
+  const char *name;
+  filter_config_t config;
+} filter_case_t;
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static const filter_case_t cases[] = {
+    {"none", {0}},
+    {"boxcar 10 (IRQ default)", FILTER_CONFIG(FILTER_STAGE_BOXCAR(10))},
+    {"boxcar 4", FILTER_CONFIG(FILTER_STAGE_BOXCAR(4))},
+    {"median 3", FILTER_CONFIG(FILTER_STAGE_MEDIAN(3))},
+    {"median 5", FILTER_CONFIG(FILTER_STAGE_MEDIAN(5))},
+    {"iir 1/4", FILTER_CONFIG(FILTER_STAGE_IIR(2))},
+    {"iir 1/8", FILTER_CONFIG(FILTER_STAGE_IIR(3))},
+    {"median 3 + boxcar 4", FILTER_CONFIG(FILTER_STAGE_MEDIAN(3), FILTER_STAGE_BOXCAR(4))},
+    {"median 3 + iir 1/4", FILTER_CONFIG(FILTER_STAGE_MEDIAN(3), FILTER_STAGE_IIR(2))},
+    {"one-euro", FILTER_CONFIG(FILTER_STAGE_ONE_EURO(1000, 20000, 1000))},
+    {"median 3 + one-euro", FILTER_CONFIG(FILTER_STAGE_MEDIAN(3), FILTER_STAGE_ONE_EURO(1000, 20000, 1000))},
+    {"median 5 + one-euro", FILTER_CONFIG(FILTER_STAGE_MEDIAN(5), FILTER_STAGE_ONE_EURO(1000, 20000, 1000))},
+};
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+static uint32_t lcg;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+// Roughly Gaussian noise from the sum of four uniform values, with a spike
+// every SPIKE_INTERVAL samples on average
+static int32_t noise(void) {
+  int32_t sum = 0;
+  for (int i = 0; i < 4; i++) {
+    lcg = lcg * 1664525u + 1013904223u;
+    sum += (int32_t)(lcg >> 24) - 128;
+  }
+
+  lcg = lcg * 1664525u + 1013904223u;
+  if ((lcg >> 16) % SPIKE_INTERVAL == 0) {
+    return (lcg & 1) ? SPIKE_AMPLITUDE : -SPIKE_AMPLITUDE;
+  }
+  return sum * NOISE_AMPLITUDE / 256;
+}
+
+static uint16_t clamp_axis(int32_t value) {
+  return value < 0 ? 0 : value > JOYSTICK_AXIS_FULL_SCALE ? JOYSTICK_AXIS_FULL_SCALE : (uint16_t)value;
+}
+
+//-----------------------------------------------------------------------------
+// Main entry point
+//-----------------------------------------------------------------------------
+
+int main(void) {
+  filter_chain_t chain;
+  int failures = 0;
+
+  printf("filter chain response, one sample every %u us per axis\n", SAMPLE_PERIOD_US);
+  printf("%-24s %9s %9s %10s %10s\n", "", "t50 (us)", "t90 (us)", "jitter rms", "worst dev");
+
+  for (unsigned int c = 0; c < NUM_CASES; c++) {
+    uint32_t now_us = 0;
+
+    // Clean step, so the response times are down to the filter alone
+    filter_chain_init(&chain, &cases[c].config);
+    for (int i = 0; i < SETTLE_SAMPLES; i++) {
+      filter_chain_process(&chain, STEP_LOW, now_us += SAMPLE_PERIOD_US);
+    }
+
+    // The step lands just after the last low sample
+    uint32_t step_us = now_us;
+    uint32_t t50_us = 0;
+    uint32_t t90_us = 0;
+    for (int i = 0; i < STEP_SAMPLES && !t90_us; i++) {
+      uint16_t value = filter_chain_process(&chain, STEP_HIGH, now_us += SAMPLE_PERIOD_US);
+
+      if (!t50_us && value >= STEP_LOW + (STEP_HIGH - STEP_LOW) / 2) {
+        t50_us = now_us - step_us;
+      }
+      if (value >= STEP_LOW + (STEP_HIGH - STEP_LOW) * 9 / 10) {
+        t90_us = now_us - step_us;
+      }
+    }
+
+    // Noisy stick held still
+    lcg = 12345;
+    filter_chain_init(&chain, &cases[c].config);
+    double square_sum = 0;
+    int32_t worst = 0;
+    for (int i = 0; i < SETTLE_SAMPLES + NOISE_SAMPLES; i++) {
+      int32_t error = (int32_t)filter_chain_process(&chain, clamp_axis(STEP_HIGH + noise()), now_us += SAMPLE_PERIOD_US) - STEP_HIGH;
+
+      if (i >= SETTLE_SAMPLES) {
+        square_sum += (double)error * error;
+        if (abs(error) > worst) {
+          worst = abs(error);
+        }
+      }
+    }
+
+    if (!t90_us) {
+      failures++;
+      printf("%-24s %9s %9s\n", cases[c].name, "-", "never");
+      continue;
+    }
+    printf("%-24s %9u %9u %10.1f %10d\n", cases[c].name, t50_us, t90_us, sqrt(square_sum / NOISE_SAMPLES), worst);
+  }
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,685 @@
+//-----------------------------------------------------------------------------
+// Simulated Pico SDK peripherals and TinyUSB HID endpoint for host builds
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/flash.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/structs/scb.h"
+#include "hardware/sync.h"
+#include "host_hal.h"
+#include "pico/multicore.h"
+#include "pico/time.h"
+#include "tusb.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define NUM_GPIOS 30
+#define ADC_FIFO_DEPTH 4
+#define ADC_NUM_INPUTS 5
+#define ADC_CONVERSION_US 2  // 96 cycles of the 48 MHz ADC clock
+#define HID_MAX_REPORT_LEN 64
+#define FRAME_US 1000
+#define SOF_CALLBACK_MAX_DELAY_US 31  // Standing in for the wait for tud_task() to run
+#define NUM_ALARMS 4
+
+//-----------------------------------------------------------------------------
+// Public variables
+//-----------------------------------------------------------------------------
+
+// Zero rather than erased at start-up, which no valid record can match.
+// Deliberately kept across host_hal_reset(), like real flash across a reboot.
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+armv6m_scb_hw_t host_scb_registers;
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static uint64_t now_us;
+static struct repeating_timer *timers;
+
+// One-shot alarms, each run from a repeating timer of its own
+static struct {
+  bool in_use;
+  alarm_callback_t callback;
+  void *user_data;
+  struct repeating_timer timer;
+} alarms[NUM_ALARMS];
+
+static irq_handler_t irq_handlers[NUM_IRQS];
+static bool irq_enabled[NUM_IRQS];
+
+static struct {
+  bool level;
+  uint32_t irq_enabled_mask;
+  uint32_t irq_event_mask;
+  irq_handler_t handler;
+} gpios[NUM_GPIOS];
+
+static struct {
+  uint16_t fifo[ADC_FIFO_DEPTH];
+  uint8_t fifo_count;
+  uint16_t threshold;
+  bool dreq_enabled;
+  bool irq_enabled;
+  bool running;
+  unsigned int input;
+  uint16_t levels[ADC_NUM_INPUTS];  // What a one-shot conversion of each input reads
+} adc;
+
+static adc_hw_t adc_registers;
+adc_hw_t *const adc_hw = &adc_registers;
+
+static struct {
+  bool claimed;
+  bool busy;
+  bool irq0_enabled;
+  bool irq0_status;
+  dma_channel_config config;
+  volatile uint8_t *write_addr;
+  const volatile void *read_addr;
+  uint32_t transfer_count;
+  uint32_t remaining;
+} dma_channels[NUM_DMA_CHANNELS];
+
+static __thread unsigned int core_num = 0;
+static pthread_t core1_thread;
+static bool core1_running;
+static volatile bool core1_stop;
+static volatile bool core1_sleeping;
+static bool core1_waiting;
+static pthread_mutex_t event_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t event_cond = PTHREAD_COND_INITIALIZER;
+static bool event_pending;
+static void (*core1_entry)(void);
+
+static bool hid_ready = true;
+static uint64_t hid_poll_interval_us = 1000;
+static uint64_t hid_busy_until_us;
+static bool hid_in_flight;
+static uint8_t hid_report[HID_MAX_REPORT_LEN];
+static uint16_t hid_report_len;
+static uint32_t hid_report_count;
+static host_hid_report_hook_t hid_report_hook;
+
+static bool sof_enabled;
+static uint64_t next_sof_us;
+static uint64_t sof_callback_us;  // When the SOF callback for next_sof_us runs
+static uint32_t frame_number;
+static uint32_t sof_lcg;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+// Block until core 1 has dealt with every event sent to it and gone back to
+// sleep, so that simulations are repeatable
+static void wait_for_core1_idle(void) {
+  while (1) {
+    pthread_mutex_lock(&event_mutex);
+    bool idle = core1_waiting && !event_pending;
+    pthread_mutex_unlock(&event_mutex);
+
+    if (idle) {
+      return;
+    }
+    sched_yield();
+  }
+}
+
+static void raise_irq(unsigned int num) {
+  if (irq_enabled[num] && irq_handlers[num]) {
+    irq_handlers[num]();
+    __sev();
+
+    if (core1_running && core_num == 0) {
+      wait_for_core1_idle();
+    }
+  }
+}
+
+static void *core1_thread_main(void *arg) {
+  core_num = 1;
+  core1_entry();
+  return NULL;
+}
+
+// Deliver a value to the busy DMA channel paced by the given DREQ, if there is one
+static bool dma_dreq_transfer(unsigned int dreq, uint32_t value) {
+  for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+    if (!dma_channels[ch].busy || dma_channels[ch].config.dreq != dreq) {
+      continue;
+    }
+
+    unsigned int size = 1u << dma_channels[ch].config.size;
+    memcpy((void *)dma_channels[ch].write_addr, &value, size);
+    if (dma_channels[ch].config.write_increment) {
+      // As in hardware, a write ring only ever changes the low address bits
+      uintptr_t addr = (uintptr_t)dma_channels[ch].write_addr;
+      uintptr_t next = addr + size;
+      if (dma_channels[ch].config.ring_write && dma_channels[ch].config.ring_size_bits) {
+        uintptr_t mask = ((uintptr_t)1 << dma_channels[ch].config.ring_size_bits) - 1;
+        next = (addr & ~mask) | (next & mask);
+      }
+      dma_channels[ch].write_addr = (volatile uint8_t *)next;
+    }
+
+    if (--dma_channels[ch].remaining == 0) {
+      dma_channels[ch].busy = false;
+      if (dma_channels[ch].config.chain_to != ch) {
+        dma_channel_start(dma_channels[ch].config.chain_to);
+      }
+      if (dma_channels[ch].irq0_enabled) {
+        dma_channels[ch].irq0_status = true;
+        raise_irq(DMA_IRQ_0);
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+static bool alarm_timer_callback(repeating_timer_t *t) {
+  alarm_id_t id = (alarm_id_t)(intptr_t)t->user_data;
+  int64_t again_us = alarms[id - 1].callback(id, alarms[id - 1].user_data);
+
+  // As for the SDK, a negative delay is measured from when the alarm was due
+  // and a positive one from now, which on the simulated clock are the same
+  if (again_us) {
+    t->delay_us = again_us < 0 ? -again_us : again_us;
+    t->next_us = now_us + t->delay_us;
+    return true;
+  }
+  alarms[id - 1].in_use = false;
+  return false;
+}
+
+static void gpio_bank_irq(void) {
+  for (unsigned int pin = 0; pin < NUM_GPIOS; pin++) {
+    if (gpios[pin].irq_event_mask && gpios[pin].handler) {
+      gpios[pin].handler();
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Host control functions
+//-----------------------------------------------------------------------------
+
+void host_hal_reset(void) {
+  multicore_reset_core1();
+  now_us = 0;
+  timers = NULL;
+  memset(irq_handlers, 0, sizeof(irq_handlers));
+  memset(irq_enabled, 0, sizeof(irq_enabled));
+  memset(gpios, 0, sizeof(gpios));
+  memset(&adc, 0, sizeof(adc));
+  memset(&adc_registers, 0, sizeof(adc_registers));
+  memset(dma_channels, 0, sizeof(dma_channels));
+  memset(alarms, 0, sizeof(alarms));
+  hid_ready = true;
+  hid_poll_interval_us = 1000;
+  hid_busy_until_us = 0;
+  hid_in_flight = false;
+  hid_report_count = 0;
+  hid_report_hook = NULL;
+  sof_enabled = false;
+  next_sof_us = FRAME_US;
+  sof_callback_us = FRAME_US;
+  frame_number = 0;
+  sof_lcg = 1;
+}
+
+void host_advance_time_us(uint64_t us) {
+  uint64_t target = now_us + us;
+
+  // Fire timers and report completions in deadline order so callbacks
+  // observe a monotonic clock
+  while (1) {
+    struct repeating_timer *due = NULL;
+    for (struct repeating_timer *t = timers; t; t = t->next) {
+      if (t->next_us <= target && (!due || t->next_us < due->next_us)) {
+        due = t;
+      }
+    }
+
+    if (hid_in_flight && hid_busy_until_us <= target && (!due || hid_busy_until_us <= due->next_us)) {
+      now_us = hid_busy_until_us;
+      hid_in_flight = false;
+      tud_hid_report_complete_cb(0, hid_report, hid_report_len);
+      continue;
+    }
+
+    // TinyUSB runs the SOF callback from tud_task(), so a little after the
+    // frame starts
+    if (sof_enabled && sof_callback_us <= target && (!due || sof_callback_us < due->next_us)) {
+      now_us = sof_callback_us;
+      frame_number++;
+      next_sof_us += FRAME_US;
+      sof_lcg = sof_lcg * 1664525u + 1013904223u;
+      sof_callback_us = next_sof_us + (sof_lcg >> 27) % (SOF_CALLBACK_MAX_DELAY_US + 1);
+      tud_sof_cb(frame_number & 0x7FF);
+      continue;
+    }
+
+    if (!due) {
+      break;
+    }
+
+    now_us = due->next_us;
+    due->next_us += due->delay_us;
+    if (!due->callback(due)) {
+      cancel_repeating_timer(due);
+    }
+  }
+
+  now_us = target;
+}
+
+void host_adc_push(uint16_t value) {
+  if (adc.dreq_enabled && dma_dreq_transfer(DREQ_ADC, value)) {
+    return;
+  }
+
+  if (adc.fifo_count < ADC_FIFO_DEPTH) {
+    adc.fifo[adc.fifo_count++] = value;
+  }
+
+  if (adc.irq_enabled && adc.fifo_count >= adc.threshold) {
+    raise_irq(ADC_IRQ_FIFO);
+  }
+}
+
+bool host_adc_running(void) {
+  return adc.running;
+}
+
+void host_adc_set_level(unsigned int input, uint16_t value) {
+  adc.levels[input] = value;
+}
+
+void host_gpio_set(unsigned int pin, bool level) {
+  if (gpios[pin].level == level) {
+    return;
+  }
+  gpios[pin].level = level;
+
+  uint32_t event = level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+  if (gpios[pin].irq_enabled_mask & event) {
+    gpios[pin].irq_event_mask |= event;
+    raise_irq(IO_IRQ_BANK0);
+  }
+}
+
+void host_set_hid_report_hook(host_hid_report_hook_t hook) {
+  hid_report_hook = hook;
+}
+
+void host_set_hid_ready(bool ready) {
+  hid_ready = ready;
+}
+
+void host_set_hid_poll_interval_ms(uint32_t interval_ms) {
+  hid_poll_interval_us = interval_ms * 1000u;
+}
+
+uint32_t host_hid_report_count(void) {
+  return hid_report_count;
+}
+
+//-----------------------------------------------------------------------------
+// pico/time.h
+//-----------------------------------------------------------------------------
+
+uint64_t time_us_64(void) {
+  return now_us;
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out) {
+  // Negative delays are measured from the previous start time, which is
+  // all the simulated clock supports anyway
+  out->delay_us = delay_us < 0 ? -delay_us : delay_us;
+  out->next_us = now_us + out->delay_us;
+  out->callback = callback;
+  out->user_data = user_data;
+  out->next = timers;
+  timers = out;
+  return true;
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+  if (us == 0 && fire_if_past) {
+    callback(0, user_data);
+    return 0;
+  }
+
+  for (alarm_id_t id = 1; id <= NUM_ALARMS; id++) {
+    if (!alarms[id - 1].in_use) {
+      alarms[id - 1].in_use = true;
+      alarms[id - 1].callback = callback;
+      alarms[id - 1].user_data = user_data;
+      add_repeating_timer_us(us, &alarm_timer_callback, (void *)(intptr_t)id, &alarms[id - 1].timer);
+      return id;
+    }
+  }
+  return -1;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id) {
+  if (alarm_id < 1 || alarm_id > NUM_ALARMS || !alarms[alarm_id - 1].in_use) {
+    return false;
+  }
+  alarms[alarm_id - 1].in_use = false;
+  return cancel_repeating_timer(&alarms[alarm_id - 1].timer);
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+  for (struct repeating_timer **t = &timers; *t; t = &(*t)->next) {
+    if (*t == timer) {
+      *t = timer->next;
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+// hardware/sync.h and pico/multicore.h
+//-----------------------------------------------------------------------------
+
+void __wfe(void) {
+  if (core_num == 1) {
+    if (core1_stop) {
+      pthread_exit(NULL);
+    }
+    core1_sleeping = true;
+  }
+
+  // Wait for an event, with a timeout standing in for the periodic
+  // interrupts that would eventually wake a real core
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += 1000000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  pthread_mutex_lock(&event_mutex);
+  if (!event_pending) {
+    core1_waiting = core_num == 1;
+    pthread_cond_timedwait(&event_cond, &event_mutex, &deadline);
+    core1_waiting = false;
+  }
+  event_pending = false;
+  pthread_mutex_unlock(&event_mutex);
+}
+
+void __sev(void) {
+  if (!core1_running) {
+    return;
+  }
+
+  pthread_mutex_lock(&event_mutex);
+  event_pending = true;
+  pthread_cond_broadcast(&event_cond);
+  pthread_mutex_unlock(&event_mutex);
+}
+
+unsigned int get_core_num(void) {
+  return core_num;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+  multicore_reset_core1();
+
+  core1_entry = entry;
+  core1_stop = false;
+  core1_sleeping = false;
+  core1_running = true;
+  pthread_create(&core1_thread, NULL, &core1_thread_main, NULL);
+
+  // Let core 1 finish its setup, so that simulated hardware events raised
+  // straight after launch are not missed
+  while (!core1_sleeping) {
+    sched_yield();
+  }
+}
+
+void multicore_reset_core1(void) {
+  if (!core1_running) {
+    return;
+  }
+
+  // Core 1 is stopped the next time it sleeps
+  core1_stop = true;
+  __sev();
+  pthread_join(core1_thread, NULL);
+  core1_running = false;
+}
+
+//-----------------------------------------------------------------------------
+// hardware/irq.h
+//-----------------------------------------------------------------------------
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler) {
+  irq_handlers[num] = handler;
+}
+
+void irq_set_enabled(unsigned int num, bool enabled) {
+  irq_enabled[num] = enabled;
+}
+
+//-----------------------------------------------------------------------------
+// hardware/gpio.h
+//-----------------------------------------------------------------------------
+
+void gpio_init(unsigned int gpio) {
+  gpios[gpio].level = false;
+}
+
+void gpio_set_dir(unsigned int gpio, bool out) {}
+
+void gpio_pull_up(unsigned int gpio) {
+  gpios[gpio].level = true;
+}
+
+bool gpio_get(unsigned int gpio) {
+  return gpios[gpio].level;
+}
+
+void gpio_add_raw_irq_handler(unsigned int gpio, irq_handler_t handler) {
+  gpios[gpio].handler = handler;
+  irq_handlers[IO_IRQ_BANK0] = &gpio_bank_irq;
+}
+
+void gpio_set_irq_enabled(unsigned int gpio, uint32_t event_mask, bool enabled) {
+  if (enabled) {
+    gpios[gpio].irq_enabled_mask |= event_mask;
+  } else {
+    gpios[gpio].irq_enabled_mask &= ~event_mask;
+  }
+}
+
+uint32_t gpio_get_irq_event_mask(unsigned int gpio) {
+  return gpios[gpio].irq_event_mask;
+}
+
+void gpio_acknowledge_irq(unsigned int gpio, uint32_t event_mask) {
+  gpios[gpio].irq_event_mask &= ~event_mask;
+}
+
+//-----------------------------------------------------------------------------
+// hardware/adc.h
+//-----------------------------------------------------------------------------
+
+void adc_init(void) {}
+void adc_gpio_init(unsigned int gpio) {}
+
+void adc_select_input(unsigned int input) {
+  adc.input = input;
+}
+
+void adc_set_round_robin(unsigned int input_mask) {}
+void adc_set_clkdiv(float clkdiv) {}
+void adc_run(bool run) {
+  adc.running = run;
+}
+
+// Blocks for the conversion, without firing any timers that fall due
+uint16_t adc_read(void) {
+  now_us += ADC_CONVERSION_US;
+  return adc.levels[adc.input];
+}
+
+void adc_fifo_drain(void) {
+  adc.fifo_count = 0;
+}
+
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift) {
+  adc.threshold = dreq_thresh;
+  adc.dreq_enabled = dreq_en;
+  adc.fifo_count = 0;
+}
+
+void adc_irq_set_enabled(bool enabled) {
+  adc.irq_enabled = enabled;
+}
+
+uint16_t adc_fifo_get(void) {
+  uint16_t value = adc.fifo[0];
+
+  if (adc.fifo_count) {
+    adc.fifo_count--;
+    memmove(&adc.fifo[0], &adc.fifo[1], adc.fifo_count * sizeof(adc.fifo[0]));
+  }
+
+  return value;
+}
+
+unsigned int adc_fifo_get_level(void) {
+  return adc.fifo_count;
+}
+
+//-----------------------------------------------------------------------------
+// hardware/flash.h
+//-----------------------------------------------------------------------------
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+  memset(&host_flash[flash_offs], 0xFF, count);
+}
+
+// Programming can only clear bits, as on the real part
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    host_flash[flash_offs + i] &= data[i];
+  }
+}
+
+//-----------------------------------------------------------------------------
+// hardware/dma.h
+//-----------------------------------------------------------------------------
+
+int dma_claim_unused_channel(bool required) {
+  for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+    if (!dma_channels[ch].claimed) {
+      dma_channels[ch].claimed = true;
+      return ch;
+    }
+  }
+  return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(unsigned int channel) {
+  dma_channel_config config = {DMA_SIZE_32, true, false, DREQ_FORCE, channel};
+  return config;
+}
+
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint32_t transfer_count, bool trigger) {
+  dma_channels[channel].config = *config;
+  dma_channels[channel].write_addr = write_addr;
+  dma_channels[channel].read_addr = read_addr;
+  dma_channels[channel].transfer_count = transfer_count;
+  if (trigger) {
+    dma_channel_start(channel);
+  }
+}
+
+void dma_channel_set_write_addr(unsigned int channel, volatile void *write_addr, bool trigger) {
+  dma_channels[channel].write_addr = write_addr;
+  if (trigger) {
+    dma_channel_start(channel);
+  }
+}
+
+void dma_channel_start(unsigned int channel) {
+  // Like the real WRITE_ADDR register, the address carries on from where the
+  // last transfer finished unless it has been rewritten, but the count reloads
+  dma_channels[channel].remaining = dma_channels[channel].transfer_count;
+  dma_channels[channel].busy = true;
+}
+
+void dma_channel_abort(unsigned int channel) {
+  dma_channels[channel].busy = false;
+}
+
+void dma_channel_set_irq0_enabled(unsigned int channel, bool enabled) {
+  dma_channels[channel].irq0_enabled = enabled;
+}
+
+bool dma_channel_get_irq0_status(unsigned int channel) {
+  return dma_channels[channel].irq0_status;
+}
+
+void dma_channel_acknowledge_irq0(unsigned int channel) {
+  dma_channels[channel].irq0_status = false;
+}
+
+//-----------------------------------------------------------------------------
+// TinyUSB HID
+//-----------------------------------------------------------------------------
+
+// Weak, as in TinyUSB, for firmware builds that do not take SOF callbacks
+__attribute__((weak)) void tud_sof_cb(uint32_t frame_count) {}
+
+void tud_sof_cb_enable(bool en) {
+  sof_enabled = en;
+  next_sof_us = (now_us / FRAME_US + 1) * FRAME_US;
+  sof_callback_us = next_sof_us;
+}
+
+bool tud_hid_ready(void) {
+  return hid_ready && now_us >= hid_busy_until_us;
+}
+
+bool tud_hid_report(uint8_t report_id, void const *report, uint16_t len) {
+  if (!tud_hid_ready()) {
+    return false;
+  }
+
+  // The endpoint stays busy until the host's next poll collects the report
+  hid_busy_until_us = (now_us / hid_poll_interval_us + 1) * hid_poll_interval_us;
+  hid_report_len = len < HID_MAX_REPORT_LEN ? len : HID_MAX_REPORT_LEN;
+  memcpy(hid_report, report, hid_report_len);
+  hid_in_flight = true;
+  hid_report_count++;
+  if (hid_report_hook) {
+    hid_report_hook(now_us, report, len);
+  }
+  return true;
+}
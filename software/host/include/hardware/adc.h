@@ -0,0 +1,42 @@
+//-----------------------------------------------------------------------------
+// Host stub for the Pico SDK hardware/adc.h API
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __HOST_HARDWARE_ADC_H__
+#define __HOST_HARDWARE_ADC_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/irq.h"
+
+typedef struct {
+  volatile uint32_t cs;
+  volatile uint32_t result;
+  volatile uint32_t fcs;
+  volatile uint32_t fifo;
+  volatile uint32_t div;
+  volatile uint32_t intr;
+  volatile uint32_t inte;
+  volatile uint32_t intf;
+  volatile uint32_t ints;
+} adc_hw_t;
+
+extern adc_hw_t *const adc_hw;
+
+void adc_init(void);
+void adc_gpio_init(unsigned int gpio);
+void adc_select_input(unsigned int input);
+void adc_set_round_robin(unsigned int input_mask);
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift);
+void adc_set_clkdiv(float clkdiv);
+void adc_irq_set_enabled(bool enabled);
+void adc_run(bool run);
+void adc_fifo_drain(void);
+uint16_t adc_read(void);
+uint16_t adc_fifo_get(void);
+unsigned int adc_fifo_get_level(void);
+
+#endif  // __HOST_HARDWARE_ADC_H__
@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+// Host stub for the Pico SDK hardware/dma.h API
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __HOST_HARDWARE_DMA_H__
+#define __HOST_HARDWARE_DMA_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hardware/irq.h"
+
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size {
+  DMA_SIZE_8 = 0,
+  DMA_SIZE_16 = 1,
+  DMA_SIZE_32 = 2,
+};
+
+enum dreq_num {
+  DREQ_PIO0_RX0 = 4,
+  DREQ_ADC = 36,
+  DREQ_FORCE = 63,
+};
+
+typedef struct {
+  enum dma_channel_transfer_size size;
+  bool read_increment;
+  bool write_increment;
+  unsigned int dreq;
+  unsigned int chain_to;
+  bool ring_write;             // Whether the ring applies to the write address rather than the read
+  unsigned int ring_size_bits; // Address bits that wrap, or 0 for no ring
+} dma_channel_config;
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(unsigned int channel);
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) { c->size = size; }
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) { c->read_increment = incr; }
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) { c->write_increment = incr; }
+static inline void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq) { c->dreq = dreq; }
+static inline void channel_config_set_chain_to(dma_channel_config *c, unsigned int chain_to) { c->chain_to = chain_to; }
+static inline void channel_config_set_ring(dma_channel_config *c, bool write, unsigned int size_bits) {
+  c->ring_write = write;
+  c->ring_size_bits = size_bits;
+}
+
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint32_t transfer_count, bool trigger);
+void dma_channel_set_write_addr(unsigned int channel, volatile void *write_addr, bool trigger);
+void dma_channel_start(unsigned int channel);
+void dma_channel_abort(unsigned int channel);
+void dma_channel_set_irq0_enabled(unsigned int channel, bool enabled);
+bool dma_channel_get_irq0_status(unsigned int channel);
+void dma_channel_acknowledge_irq0(unsigned int channel);
+
+#endif  // __HOST_HARDWARE_DMA_H__
@@ -0,0 +1,33 @@
+//-----------------------------------------------------------------------------
+// Host stub for the Pico SDK hardware/irq.h API
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __HOST_HARDWARE_IRQ_H__
+#define __HOST_HARDWARE_IRQ_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PICO_DEFAULT_IRQ_PRIORITY 0x80
+
+typedef void (*irq_handler_t)(void);
+
+enum irq_num {
+  TIMER_IRQ_0 = 0,
+  USBCTRL_IRQ = 5,
+  DMA_IRQ_0 = 11,
+  DMA_IRQ_1 = 12,
+  IO_IRQ_BANK0 = 13,
+  SIO_IRQ_PROC0 = 15,
+  SIO_IRQ_PROC1 = 16,
+  ADC_IRQ_FIFO = 22,
+  NUM_IRQS = 32,
+};
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler);
+void irq_set_enabled(unsigned int num, bool enabled);
+static inline void irq_set_priority(unsigned int num, uint8_t hardware_priority) {}
+
+#endif  // __HOST_HARDWARE_IRQ_H__
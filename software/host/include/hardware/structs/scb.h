@@ -0,0 +1,26 @@
+//-----------------------------------------------------------------------------
+// Host stub for the Pico SDK hardware/structs/scb.h registers
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __HOST_HARDWARE_STRUCTS_SCB_H__
+#define __HOST_HARDWARE_STRUCTS_SCB_H__
+
+#include <stdint.h>
+
+#define M0PLUS_SCR_SEVONPEND_BITS 0x00000010
+
+typedef struct {
+  volatile uint32_t cpuid;
+  volatile uint32_t icsr;
+  volatile uint32_t vtor;
+  volatile uint32_t aircr;
+  volatile uint32_t scr;
+} armv6m_scb_hw_t;
+
+// Nothing reads these back, so the registers are just memory
+extern armv6m_scb_hw_t host_scb_registers;
+#define scb_hw (&host_scb_registers)
+
+#endif  // __HOST_HARDWARE_STRUCTS_SCB_H__
@@ -0,0 +1,24 @@
+//-----------------------------------------------------------------------------
+// Host stub for the Pico SDK hardware/sync.h API
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __HOST_HARDWARE_SYNC_H__
+#define __HOST_HARDWARE_SYNC_H__
+
+#include <stdint.h>
+
+// Simulated interrupts run synchronously from the caller, so there is never
+// anything to mask
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+static inline void __dmb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+// Simulated cores are threads, with each "interrupt" delivering a wake-up event
+void __wfe(void);
+void __sev(void);
+unsigned int get_core_num(void);
+
+#endif  // __HOST_HARDWARE_SYNC_H__
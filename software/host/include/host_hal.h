@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// Host-side controls for the simulated Pico hardware used by host builds
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __HOST_HAL_H__
+#define __HOST_HAL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+// Invoked by the fake tud_hid_report() for every report the firmware sends
+typedef void (*host_hid_report_hook_t)(uint64_t time_us, const void *report, uint16_t len);
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+// Reset all simulated peripherals and the simulated clock
+void host_hal_reset(void);
+
+// Move the simulated clock forward, firing any repeating timers that fall due
+void host_advance_time_us(uint64_t us);
+
+// Complete one ADC conversion, raising the FIFO interrupt if it is enabled and
+// the FIFO has reached its threshold
+void host_adc_push(uint16_t value);
+
+// Whether the firmware has the ADC running, for simulating conversions only
+// when it has started them
+bool host_adc_running(void);
+
+// Set the value adc_read() returns for an ADC input
+void host_adc_set_level(unsigned int input, uint16_t value);
+
+// Drive a GPIO input to the given level, raising any edge interrupts enabled on it
+void host_gpio_set(unsigned int pin, bool level);
+
+// Install a hook that observes every HID report sent by the firmware
+void host_set_hid_report_hook(host_hid_report_hook_t hook);
+
+// Set the value returned by tud_hid_ready()
+void host_set_hid_ready(bool ready);
+
+// Set how often the simulated host polls the HID endpoint, freeing it for the
+// next report. Polls fall on 1 ms frame boundaries. Once the firmware enables
+// it, the SOF callback runs up to 31 us after each boundary, as it would from
+// tud_task().
+void host_set_hid_poll_interval_ms(uint32_t interval_ms);
+
+// Number of HID reports sent since the last reset
+uint32_t host_hid_report_count(void);
+
+#endif  // __HOST_HAL_H__
@@ -0,0 +1,18 @@
+//-----------------------------------------------------------------------------
+// Host stub for the Pico SDK pico/multicore.h API, running core 1 as a thread
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __HOST_PICO_MULTICORE_H__
+#define __HOST_PICO_MULTICORE_H__
+
+void multicore_launch_core1(void (*entry)(void));
+void multicore_reset_core1(void);
+
+// Simulated flash writes are instantaneous, so core 1 never needs to be parked
+static inline void multicore_lockout_victim_init(void) {}
+static inline void multicore_lockout_start_blocking(void) {}
+static inline void multicore_lockout_end_blocking(void) {}
+
+#endif  // __HOST_PICO_MULTICORE_H__
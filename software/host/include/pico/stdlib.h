@@ -0,0 +1,21 @@
+//-----------------------------------------------------------------------------
+// Host stub for the Pico SDK pico/stdlib.h umbrella header
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __HOST_PICO_STDLIB_H__
+#define __HOST_PICO_STDLIB_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hardware/gpio.h"
+#include "pico/time.h"
+
+// From pico/platform.h
+static inline void tight_loop_contents(void) {}
+
+#endif  // __HOST_PICO_STDLIB_H__
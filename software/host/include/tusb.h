@@ -0,0 +1,26 @@
+//-----------------------------------------------------------------------------
+// Host stub for the subset of TinyUSB used by the HID report path
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __HOST_TUSB_H__
+#define __HOST_TUSB_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TU_ATTR_PACKED __attribute__((packed))
+
+static inline void tud_task(void) {}
+bool tud_hid_ready(void);
+bool tud_hid_report(uint8_t report_id, void const *report, uint16_t len);
+void tud_sof_cb_enable(bool en);
+
+// Implemented by the firmware
+void tud_mount_cb(void);
+void tud_sof_cb(uint32_t frame_count);
+bool tud_hid_set_idle_cb(uint8_t instance, uint8_t idle_rate);
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len);
+
+#endif  // __HOST_TUSB_H__
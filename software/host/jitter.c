@@ -0,0 +1,157 @@
+//-----------------------------------------------------------------------------
+// Host benchmark for HID report timing jitter with a blocking debug print
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_hal.h"
+#include "joystick.h"
+#include "latency.h"
+#include "pico/time.h"
+#include "pins.h"
+#include "scheduler.h"
+#include "usb_hid.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define SIMULATED_SECONDS 60
+#define MAIN_LOOP_PERIOD_US 5  // Simulated cost of one pass of the main loop
+
+// main.c prints two lines of about 55 characters every second, at 115200 baud
+// with 10 bits per character
+#define DEBUG_PRINT_INTERVAL_US 1000000
+#define DEBUG_PRINT_COST_US (110 * 10 * 1000000 / 115200)
+
+// The print and report timers are independent, so start the print half a
+// report interval out of phase rather than conveniently just after a report
+#define DEBUG_PRINT_PHASE_US (USB_HID_POLL_INTERVAL_MS * 1000 / 2)
+
+// Button 1 is pressed and released on a period that drifts against the report timer
+#define BUTTON_TOGGLE_INTERVAL_US 73013
+
+// Histogram bucket upper bounds for report interval deviation, in us
+static const uint32_t bucket_limits_us[] = {10, 50, 100, 500, 1000, 5000, 10000, UINT32_MAX};
+#define NUM_BUCKETS (sizeof(bucket_limits_us) / sizeof(bucket_limits_us[0]))
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static uint64_t last_report_us;
+static uint32_t num_intervals;
+static uint32_t histogram[NUM_BUCKETS];
+static uint64_t deviation_sum_us;
+static uint64_t deviation_max_us;
+static uint64_t sample_time_ns;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static void report_hook(uint64_t time_us, const void *report, uint16_t len) {
+  if (last_report_us) {
+    uint64_t interval = time_us - last_report_us;
+    uint64_t nominal = USB_HID_POLL_INTERVAL_MS * 1000;
+    uint64_t deviation = interval > nominal ? interval - nominal : nominal - interval;
+
+    for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
+      if (deviation <= bucket_limits_us[i]) {
+        histogram[i]++;
+        break;
+      }
+    }
+    deviation_sum_us += deviation;
+    if (deviation > deviation_max_us) {
+      deviation_max_us = deviation;
+    }
+    num_intervals++;
+  }
+  last_report_us = time_us;
+}
+
+// Advance the simulated clock, delivering ADC conversions as they complete.
+// Interrupts keep running whatever the main loop is doing.
+static void run_hardware_us(uint32_t us) {
+  static uint32_t lcg = 1;
+
+  sample_time_ns += (uint64_t)us * 1000;
+  while (sample_time_ns >= JOYSTICK_ADC_SAMPLE_PERIOD_NS) {
+    sample_time_ns -= JOYSTICK_ADC_SAMPLE_PERIOD_NS;
+    lcg = lcg * 1664525u + 1013904223u;
+    host_adc_push(1800 + (lcg >> 28));
+  }
+  host_advance_time_us(us);
+}
+
+//-----------------------------------------------------------------------------
+// Main entry point
+//-----------------------------------------------------------------------------
+
+int main(void) {
+  host_hal_reset();
+  host_set_hid_report_hook(&report_hook);
+  host_set_hid_poll_interval_ms(USB_HID_POLL_INTERVAL_MS);
+  joystick_init();
+  usb_init();
+
+  // The simulated stick barely moves, so ask for a report every tick as a
+  // host setting the shortest idle rate would, to have intervals to measure
+  tud_hid_set_idle_cb(0, 1);
+
+  uint64_t next_print_us = DEBUG_PRINT_INTERVAL_US + DEBUG_PRINT_PHASE_US;
+  uint64_t next_toggle_us = BUTTON_TOGGLE_INTERVAL_US;
+  bool button_level = true;
+  uint64_t end_us = (uint64_t)SIMULATED_SECONDS * 1000000;
+
+  // As in main.c, the USB task only runs when an interrupt has posted work
+  uint32_t wakeups = 0;
+  while (time_us_64() < end_us) {
+    run_hardware_us(MAIN_LOOP_PERIOD_US);
+    if (scheduler_take() & (1u << SCHEDULER_EVENT_INPUT | 1u << SCHEDULER_EVENT_REPORT)) {
+      usb_task();
+      wakeups++;
+    }
+
+    if (time_us_64() >= next_toggle_us) {
+      next_toggle_us += BUTTON_TOGGLE_INTERVAL_US;
+      button_level = !button_level;
+      host_gpio_set(JOYSTICK_BUTTON_1_PIN, button_level);
+    }
+
+    // With sampling on core 1, the debug print runs there instead
+    if (!JOYSTICK_CORE1 && time_us_64() >= next_print_us) {
+      next_print_us += DEBUG_PRINT_INTERVAL_US;
+      run_hardware_us(DEBUG_PRINT_COST_US);
+    }
+  }
+
+  printf("report interval deviation from %u ms (%s):\n",
+         USB_HID_POLL_INTERVAL_MS, JOYSTICK_CORE1 ? "sampling on core 1" : "single core");
+  for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
+    if (bucket_limits_us[i] == UINT32_MAX) {
+      printf("      > %5u us: %8u\n", bucket_limits_us[i - 1], histogram[i]);
+    } else {
+      printf("  <= %8u us: %8u\n", bucket_limits_us[i], histogram[i]);
+    }
+  }
+  printf("mean: %.1f us, max: %llu us, reports: %u\n",
+         (double)deviation_sum_us / num_intervals, (unsigned long long)deviation_max_us, num_intervals + 1);
+  printf("usb_task runs: %.0f/s, against %u/s when busy-polling\n", (double)wakeups / SIMULATED_SECONDS,
+         1000000 / MAIN_LOOP_PERIOD_US);
+
+  printf("\nlatency by stage:\n");
+  for (int stage = 0; stage < LATENCY_NUM_STAGES; stage++) {
+    latency_histogram_t histogram;
+    latency_read(stage, &histogram);
+    printf("  %-18s n: %6u min: %6u mean: %8.1f max: %6u us\n", latency_stage_name(stage),
+           histogram.count, histogram.min_us, histogram.count ? (double)histogram.total_us / histogram.count : 0.0,
+           histogram.max_us);
+  }
+
+  return num_intervals ? EXIT_SUCCESS : EXIT_FAILURE;
+}
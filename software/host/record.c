@@ -0,0 +1,131 @@
+//-----------------------------------------------------------------------------
+// Host session recorder: drives a synthetic stick through the firmware with
+// capture enabled, writing the capture and the HID reports it produced
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "capture.h"
+#include "host_hal.h"
+#include "joystick.h"
+#include "pico/time.h"
+#include "pins.h"
+#include "usb_hid.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define SIMULATED_SECONDS 8
+#define MAIN_LOOP_PERIOD_US 5  // Must match replay.c for the reports to match
+#define ADC_MAX_CODE 4095
+
+// Button 1 is pressed and released with some contact bounce, button 2 is
+// tapped more briefly than a report interval
+#define BUTTON_1_INTERVAL_US 173000
+#define BUTTON_1_BOUNCES 3
+#define BUTTON_1_BOUNCE_US 200
+#define BUTTON_2_INTERVAL_US 411000
+#define BUTTON_2_TAP_US 2000
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static FILE *report_file;
+static uint64_t sample_time_ns;
+static int sample_axis;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static void report_hook(uint64_t time_us, const void *report, uint16_t len) {
+  const uint8_t *bytes = report;
+
+  fprintf(report_file, "%llu", (unsigned long long)time_us);
+  for (uint16_t i = 0; i < len; i++) {
+    fprintf(report_file, " %02x", bytes[i]);
+  }
+  fprintf(report_file, "\n");
+}
+
+static void capture_write(const void *data, uint32_t len, void *context) {
+  fwrite(data, 1, len, context);
+}
+
+// Slow circles with a little noise, alternating X and Y conversions
+static uint16_t stick_code(uint64_t time_us, int axis) {
+  static uint32_t lcg = 1;
+  double phase = 2 * M_PI * time_us / 2000000.0;
+  double position = axis ? sin(phase) : cos(phase);
+
+  lcg = lcg * 1664525u + 1013904223u;
+  int32_t code = (int32_t)(ADC_MAX_CODE / 2 + position * 1500) + (int32_t)(lcg >> 28) - 8;
+  return (uint16_t)(code < 0 ? 0 : code > ADC_MAX_CODE ? ADC_MAX_CODE : code);
+}
+
+static void run_hardware_us(uint32_t us) {
+  sample_time_ns += (uint64_t)us * 1000;
+  while (sample_time_ns >= JOYSTICK_ADC_SAMPLE_PERIOD_NS) {
+    sample_time_ns -= JOYSTICK_ADC_SAMPLE_PERIOD_NS;
+    host_adc_push(stick_code(time_us_64(), sample_axis));
+    sample_axis ^= 1;
+  }
+  host_advance_time_us(us);
+}
+
+static void run_buttons(uint64_t now_us) {
+  uint64_t phase_us = now_us % BUTTON_1_INTERVAL_US;
+  bool pressed = (now_us / BUTTON_1_INTERVAL_US) & 1;
+  if (phase_us < BUTTON_1_BOUNCES * 2 * BUTTON_1_BOUNCE_US) {
+    pressed ^= (phase_us / BUTTON_1_BOUNCE_US) & 1;
+  }
+  host_gpio_set(JOYSTICK_BUTTON_1_PIN, !pressed);
+
+  host_gpio_set(JOYSTICK_BUTTON_2_PIN, now_us % BUTTON_2_INTERVAL_US >= BUTTON_2_TAP_US || now_us < BUTTON_2_INTERVAL_US);
+}
+
+//-----------------------------------------------------------------------------
+// Main entry point
+//-----------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <capture out> <reports out>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *capture_file = fopen(argv[1], "wb");
+  report_file = fopen(argv[2], "w");
+  if (!capture_file || !report_file) {
+    perror("fopen");
+    return EXIT_FAILURE;
+  }
+
+  host_hal_reset();
+  host_set_hid_report_hook(&report_hook);
+  host_set_hid_poll_interval_ms(USB_HID_POLL_INTERVAL_MS);
+  host_gpio_set(JOYSTICK_BUTTON_1_PIN, true);
+  host_gpio_set(JOYSTICK_BUTTON_2_PIN, true);
+  joystick_init();
+  usb_init();
+
+  uint64_t end_us = (uint64_t)SIMULATED_SECONDS * 1000000;
+  while (time_us_64() < end_us) {
+    run_hardware_us(MAIN_LOOP_PERIOD_US);
+    usb_task();
+    run_buttons(time_us_64());
+  }
+
+  capture_dump(&capture_write, capture_file);
+  fclose(capture_file);
+  fclose(report_file);
+
+  printf("recorded %u reports over %u s\n", host_hid_report_count(), SIMULATED_SECONDS);
+  return host_hid_report_count() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,148 @@
+//-----------------------------------------------------------------------------
+// Host replayer: feeds a capture through the firmware and prints the HID
+// report sequence it produces, with timestamps
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "calibration.h"
+#include "capture.h"
+#include "host_hal.h"
+#include "joystick.h"
+#include "pico/time.h"
+#include "pins.h"
+#include "usb_hid.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define MAIN_LOOP_PERIOD_US 5  // Must match record.c for the reports to match
+
+static const uint8_t button_pins[JOYSTICK_NUM_BUTTONS] = {JOYSTICK_BUTTON_1_PIN, JOYSTICK_BUTTON_2_PIN};
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static FILE *report_file;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static void report_hook(uint64_t time_us, const void *report, uint16_t len) {
+  const uint8_t *bytes = report;
+
+  fprintf(report_file, "%llu", (unsigned long long)time_us);
+  for (uint16_t i = 0; i < len; i++) {
+    fprintf(report_file, " %02x", bytes[i]);
+  }
+  fprintf(report_file, "\n");
+}
+
+// Put the settings back as they were when recording started. usb_init() loads
+// the calibration from flash, so this has to follow it.
+static void apply_settings(const capture_settings_t *settings) {
+  hid_config_report_t config = {settings->report_interval_ms, settings->filter_window, settings->adc_clock_div,
+                                settings->deadzone_permille};
+  usb_hid_set_feature(USB_HID_REPORT_ID_CONFIG, (const uint8_t *)&config, sizeof(config));
+
+  for (uint8_t axis = 0; axis < CALIBRATION_NUM_AXES; axis++) {
+    const capture_calibration_t *calibration = &settings->calibration[axis];
+    calibration_axis_t axis_settings = {calibration->min, calibration->centre, calibration->max,
+                                        calibration->deadzone_permille, calibration->curve_percent};
+    calibration_set(axis, &axis_settings);
+  }
+}
+
+static void replay_record(const capture_record_t *record) {
+  switch (record->type) {
+    case CAPTURE_ADC:
+      host_adc_push(record->value);
+      break;
+    case CAPTURE_BUTTON:
+      if (record->channel < JOYSTICK_NUM_BUTTONS) {
+        host_gpio_set(button_pins[record->channel], !record->value);
+      }
+      break;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Main entry point
+//-----------------------------------------------------------------------------
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <capture> [reports out]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *capture_file = fopen(argv[1], "rb");
+  report_file = argc > 2 ? fopen(argv[2], "w") : stdout;
+  if (!capture_file || !report_file) {
+    perror("fopen");
+    return EXIT_FAILURE;
+  }
+
+  capture_header_t header;
+  if (fread(&header, sizeof(header), 1, capture_file) != 1 || header.magic != CAPTURE_MAGIC ||
+      header.version != CAPTURE_VERSION || header.record_size != sizeof(capture_record_t)) {
+    fprintf(stderr, "%s: not a version %u capture\n", argv[1], CAPTURE_VERSION);
+    return EXIT_FAILURE;
+  }
+  if (header.flags != capture_flags()) {
+    fprintf(stderr, "warning: capture flags %#x do not match this build's %#x\n", header.flags, capture_flags());
+  }
+  if (header.filter_id != capture_filter_id()) {
+    fprintf(stderr, "warning: capture was made with different JOYSTICK_FILTER_STAGES\n");
+  }
+
+  capture_record_t *records = malloc((size_t)header.record_count * sizeof(capture_record_t));
+  if (!records || fread(records, sizeof(capture_record_t), header.record_count, capture_file) != header.record_count) {
+    fprintf(stderr, "%s: truncated capture\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  fclose(capture_file);
+
+  // The capture starts with the button levels in force at its first record,
+  // which are applied before the firmware starts, and the settings, which are
+  // applied before any record
+  uint32_t next = 0;
+  host_hal_reset();
+  host_set_hid_report_hook(&report_hook);
+  host_set_hid_poll_interval_ms(USB_HID_POLL_INTERVAL_MS);
+  while (next < header.record_count && next < JOYSTICK_NUM_BUTTONS && records[next].type == CAPTURE_BUTTON) {
+    replay_record(&records[next++]);
+  }
+  joystick_init();
+  usb_init();
+  apply_settings(&header.settings);
+
+  // Skip straight to the main loop pass that saw the first input
+  if (next < header.record_count) {
+    uint32_t first_us = records[next].timestamp_us;
+    host_advance_time_us(first_us - first_us % MAIN_LOOP_PERIOD_US);
+  }
+
+  // Each record is delivered on the main loop pass at its timestamp, in the
+  // same order as the recording, up until the capture was taken
+  while (time_us_64() < header.end_us) {
+    while (next < header.record_count && records[next].timestamp_us <= time_us_64()) {
+      replay_record(&records[next++]);
+    }
+    host_advance_time_us(MAIN_LOOP_PERIOD_US);
+    usb_task();
+  }
+
+  fprintf(stderr, "replayed %u records into %u reports\n", header.record_count, host_hid_report_count());
+  if (report_file != stdout) {
+    fclose(report_file);
+  }
+  free(records);
+  return EXIT_SUCCESS;
+}
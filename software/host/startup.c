@@ -0,0 +1,126 @@
+//-----------------------------------------------------------------------------
+// Host check that the first HID report after start-up already carries the
+// stick's position, in each acquisition mode. The simulated clock says
+// nothing about the real time this takes, which the firmware measures itself,
+// see usb_hid_first_report_us().
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_hal.h"
+#include "joystick.h"
+#include "pico/time.h"
+#include "pins.h"
+#include "scheduler.h"
+#include "sof_sync.h"
+#include "tusb.h"
+#include "usb_hid.h"
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define SIMULATED_SECONDS 1
+#define MAIN_LOOP_PERIOD_US 5  // Simulated cost of one pass of the main loop
+
+// Held off centre from power-up, so a centred report stands out
+#define STICK_X_CODE 1800
+#define STICK_Y_CODE 2600
+
+#define ADC_INPUT_PIN_OFFSET 26
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static uint64_t sample_time_ns;
+static int sample_axis;
+
+static hid_joystick_report_t first_report;
+static hid_joystick_report_t last_report;
+static uint32_t num_reports;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static void report_hook(uint64_t time_us, const void *report, uint16_t len) {
+  if (len != sizeof(hid_joystick_report_t)) {
+    return;
+  }
+  if (!num_reports++) {
+    memcpy(&first_report, report, len);
+  }
+  memcpy(&last_report, report, len);
+}
+
+// Advance the simulated clock, delivering ADC conversions as they complete
+static void run_hardware_us(uint32_t us) {
+  sample_time_ns += (uint64_t)us * 1000;
+  while (sample_time_ns >= JOYSTICK_ADC_SAMPLE_PERIOD_NS) {
+    sample_time_ns -= JOYSTICK_ADC_SAMPLE_PERIOD_NS;
+    if (host_adc_running()) {
+      host_adc_push(sample_axis ? STICK_Y_CODE : STICK_X_CODE);
+      sample_axis ^= 1;
+    }
+  }
+  host_advance_time_us(us);
+}
+
+//-----------------------------------------------------------------------------
+// Main entry point
+//-----------------------------------------------------------------------------
+
+int main(void) {
+  host_hal_reset();
+  host_set_hid_poll_interval_ms(USB_HID_POLL_INTERVAL_MS);
+  host_set_hid_report_hook(&report_hook);
+  host_adc_set_level(JOYSTICK_AXIS_X_PIN - ADC_INPUT_PIN_OFFSET, STICK_X_CODE);
+  host_adc_set_level(JOYSTICK_AXIS_Y_PIN - ADC_INPUT_PIN_OFFSET, STICK_Y_CODE);
+
+  // The same start-up as main.c, with the host configuring the device as soon
+  // as it is up, before any interrupt has delivered a sample
+  host_set_hid_ready(false);
+  joystick_init();
+  joystick_state_t primed;
+  joystick_read(&primed);
+  usb_init();
+  sof_sync_init();
+  host_set_hid_ready(true);
+  tud_mount_cb();
+
+  uint64_t end_us = (uint64_t)SIMULATED_SECONDS * 1000000;
+  while (time_us_64() < end_us) {
+    if (scheduler_take() & (1u << SCHEDULER_EVENT_INPUT | 1u << SCHEDULER_EVENT_REPORT)) {
+      usb_task();
+    }
+    run_hardware_us(MAIN_LOOP_PERIOD_US);
+  }
+
+  if (!num_reports) {
+    printf("no reports sent\n");
+    return EXIT_FAILURE;
+  }
+
+  // The stick is held still off centre, so once joystick_init() returns the
+  // state must already hold the values the filters settle on, and the first
+  // report must be no different from the ones that follow
+  joystick_state_t settled;
+  joystick_read(&settled);
+  bool state_primed = primed.axes_connected == settled.axes_connected && settled.axes_connected &&
+                      primed.x_axis == settled.x_axis && primed.y_axis == settled.y_axis &&
+                      primed.x_axis != JOYSTICK_AXIS_CENTRE && primed.y_axis != JOYSTICK_AXIS_CENTRE;
+  bool report_primed = !memcmp(&first_report, &last_report, sizeof(first_report));
+
+  printf("start-up (%s):\n", JOYSTICK_ADC_DMA ? "ADC DMA" : USB_HID_FAST_POLL ? "fast poll" : "timer");
+  printf("  state after init X: %u Y: %u, settled X: %u Y: %u\n", primed.x_axis, primed.y_axis, settled.x_axis,
+         settled.y_axis);
+  printf("  first report X: %d Y: %d, settled X: %d Y: %d\n", first_report.x, first_report.y, last_report.x,
+         last_report.y);
+
+  return state_primed && report_primed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -6,12 +6,34 @@
 
 #include "joystick.h"
 
-#include "buffer.h"
+#include <string.h>
+
+#include "adc_table.h"
+#include "capture.h"
+#include "edge_queue.h"
+#include "filter.h"
 #include "hardware/adc.h"
+#include "hardware/dma.h"
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "pins.h"
+#include "profile.h"
+#if JOYSTICK_AXIS_PIO || JOYSTICK_BUTTON_PIO
+#include "hardware/clocks.h"
+#include "hardware/pio.h"
+#endif
+#if JOYSTICK_AXIS_PIO
+#include "rc_timer.pio.h"
+#endif
+#if JOYSTICK_BUTTON_PIO
+#include "button_debounce.pio.h"
+#endif
+#include "scheduler.h"
+#include "snapshot.h"
+#include "telemetry.h"
 
 //-----------------------------------------------------------------------------
 // Private constants
@@ -21,75 +43,527 @@
 #define BUTTON_PRESS_EVENT GPIO_IRQ_EDGE_FALL
 #define BUTTON_RELEASE_EVENT GPIO_IRQ_EDGE_RISE
 
+#if JOYSTICK_BUTTON_PIO
+// One state machine per button, on the PIO block the axes leave free
+#define BUTTON_PIO pio1
+#define BUTTON_PIO_IRQ PIO1_IRQ_0
+#define BUTTON_PIO_CLOCK_HZ 1000000  // One state machine cycle per us, so the hold-off is counted in us
+
+// Edges from the state machines are already debounced
+#define EDGE_HOLD_OFF_US 0
+#else
+#define EDGE_HOLD_OFF_US JOYSTICK_BUTTON_DEBOUNCE_US
+#endif
+
 // Joystick axis ADC constants
-#define NUM_AXES 2
-#define ADC_CLOCK_DIV 65535      // Reduce sample rate to once every (1 + ADC_CLOCK_DIV) cycles
+#define NUM_AXES JOYSTICK_NUM_AXES
 #define ADC_INPUT_PIN_OFFSET 26  // ADC inputs are numbered from 0-4, but connected on pins 26-29
 #define AXIS_X_ADC_INPUT (JOYSTICK_AXIS_X_PIN - ADC_INPUT_PIN_OFFSET)
 #define AXIS_Y_ADC_INPUT (JOYSTICK_AXIS_Y_PIN - ADC_INPUT_PIN_OFFSET)
+#define PRIME_SAMPLES 8  // One-shot conversions per axis averaged into the first value, at 2 us each
+
+#if JOYSTICK_ADC_DMA
+// DMA drains the ADC FIFO at the full conversion rate into a ring of blocks,
+// and each completed block is decimated down to one sample per axis
+#define ADC_DMA_NUM_BLOCKS 2                                            // One DMA channel per block, chained in a ring
+#define ADC_DMA_SAMPLES_PER_AXIS_LOG2 9                                 // Samples per axis averaged into each block
+#define ADC_DMA_BLOCK_SAMPLES (NUM_AXES << ADC_DMA_SAMPLES_PER_AXIS_LOG2)  // Interleaved X, Y samples per block
+#define ADC_DMA_BLOCK_BYTES_LOG2 (ADC_DMA_SAMPLES_PER_AXIS_LOG2 + 2)        // X and Y, 2 bytes each
+
+// Each channel's write address wraps back to the start of its block in
+// hardware, so the blocks must be a power of two in size and aligned to it
+_Static_assert(ADC_DMA_BLOCK_SAMPLES * sizeof(uint16_t) == 1u << ADC_DMA_BLOCK_BYTES_LOG2,
+               "ADC DMA blocks must be a power of two in size");
+#endif
+
+#if JOYSTICK_AXIS_PIO
+// One state machine per axis, all on the same PIO block and started together
+#define RC_PIO pio0
+#define RC_PIO_IRQ PIO0_IRQ_0
 
-// ADC - joystick resistor conversion values
-#define VOLTAGE_REFERENCE 3.3f                              // Reference voltage used by ADC, and used to drive voltage divider
-#define ADC_VOLTS_PER_BIT (VOLTAGE_REFERENCE / (1 << 12));  // 12-bit ADC, assume ADC reference of 3.3V
-#define RESISTOR_FIXED_OHMS 10000                           // Value of the fixed resistor part of the voltage divider
+// The window allows for the longest charge, at full stick resistance, with
+// half as much again to spare for component tolerances
+#define RC_WINDOW_PERCENT 150
+#define RC_CYCLES_PER_COUNT 2  // Length of the charging loop in rc_timer.pio
+#endif
+
+// Every interrupt that writes the state runs at this priority, so that none
+// can interrupt another part way through a write, see snapshot.h
+#define ACQUISITION_IRQ_PRIORITY PICO_DEFAULT_IRQ_PRIORITY
+
+// ADC - joystick resistor conversion is precomputed into adc_to_axis_table at build time,
+// which must cover the same resistance range as the axis values
+_Static_assert(ADC_TABLE_MAX_RESISTANCE == JOYSTICK_AXIS_MAX_RESISTANCE,
+               "ADC lookup table range does not match JOYSTICK_AXIS_MAX_RESISTANCE");
 
 //-----------------------------------------------------------------------------
 // Private variables
 //-----------------------------------------------------------------------------
 
-static joystick_state_t state = {false, false, 0, 0};
-static buffer_t x_buffer;
-static buffer_t y_buffer;
+// Written by the acquisition interrupts only, and read from anywhere
+static snapshot_t snapshot;
+static joystick_state_t *const state = &snapshot.state;
+
+static filter_chain_t axis_filters[NUM_AXES];
+#if NUM_AXES > 2
+static uint16_t *const axis_values[NUM_AXES] = {&snapshot.state.x_axis, &snapshot.state.y_axis,
+                                                &snapshot.state.x2_axis, &snapshot.state.y2_axis};
+#else
+static uint16_t *const axis_values[NUM_AXES] = {&snapshot.state.x_axis, &snapshot.state.y_axis};
+#endif
+static const filter_config_t default_filter = FILTER_CONFIG(JOYSTICK_FILTER_STAGES);
+static const filter_config_t *volatile pending_filter = NULL;  // Swapped in by the acquisition interrupt
+static uint16_t adc_clock_div = JOYSTICK_ADC_CLOCK_DIV;
+static volatile bool acquisition_paused = false;
+
+// Button edges from the interrupts, debounced by the consumer unless the
+// state machines have already done it
+static edge_queue_t edge_queue;
+static struct {
+  bool reported;         // Level last returned by joystick_next_edge()
+  bool level;            // Latest raw level
+  uint32_t level_us;     // When the raw level last changed
+  uint32_t reported_us;  // Timestamp of the last reported edge
+} debounce[JOYSTICK_NUM_BUTTONS];
+static uint32_t edges_dropped = 0;
+
+#if JOYSTICK_NUM_BUTTONS > 2
+static const uint8_t button_pins[JOYSTICK_NUM_BUTTONS] = {JOYSTICK_BUTTON_1_PIN, JOYSTICK_BUTTON_2_PIN,
+                                                          JOYSTICK_BUTTON_3_PIN, JOYSTICK_BUTTON_4_PIN};
+static bool *const button_levels[JOYSTICK_NUM_BUTTONS] = {&snapshot.state.button_1, &snapshot.state.button_2,
+                                                          &snapshot.state.button_3, &snapshot.state.button_4};
+#else
+static const uint8_t button_pins[JOYSTICK_NUM_BUTTONS] = {JOYSTICK_BUTTON_1_PIN, JOYSTICK_BUTTON_2_PIN};
+#endif
+
+#if JOYSTICK_CORE1
+static volatile uint32_t acquisition_updates = 0;  // Bumped by each core 1 interrupt that changes the state
+static joystick_task_t background_task = NULL;
+#endif
+
+#if JOYSTICK_ADC_DMA
+static int adc_dma_channels[ADC_DMA_NUM_BLOCKS];
+static uint16_t adc_dma_blocks[ADC_DMA_NUM_BLOCKS][ADC_DMA_BLOCK_SAMPLES]
+    __attribute__((aligned(1 << ADC_DMA_BLOCK_BYTES_LOG2)));
+#endif
+
+#if JOYSTICK_AXIS_PIO
+static const uint8_t axis_pins[NUM_AXES] = {JOYSTICK_AXIS_X_PIN, JOYSTICK_AXIS_Y_PIN, JOYSTICK_AXIS_X2_PIN,
+                                            JOYSTICK_AXIS_Y2_PIN};
+static int rc_dma_channels[NUM_AXES];
+static volatile uint32_t rc_counts[NUM_AXES];  // Latest push from each state machine, written by DMA
+static uint32_t rc_window;                     // Counts in a measurement window
+static uint32_t rc_offset;                     // Counts for the series resistor alone
+static uint32_t rc_scale;                      // Axis value per count, in Q16
+static bool rc_primed;                         // Set once the first measurement is in
+#endif
 
 //-----------------------------------------------------------------------------
 // Private functions
 //-----------------------------------------------------------------------------
 
 // Analogue joystick axes are variable resistors, connected to the ADC as part of a voltage divider.
-// This function converts the ADC value back into the resistance set by the stick.
-inline float convert_adc_value_to_resistance(uint16_t value) {
-  float voltage = value * ADC_VOLTS_PER_BIT;
-  float resistance = RESISTOR_FIXED_OHMS * ((VOLTAGE_REFERENCE / voltage) - 1);
-  return resistance;
+// This function converts the ADC value back into the resistance set by the stick, as an axis value.
+static inline uint16_t convert_adc_value_to_axis(uint16_t value) {
+  PROFILE_SCOPE(PROFILE_ADC_CONVERT);
+  return adc_to_axis_table[value & (ADC_TABLE_SIZE - 1)];
+}
+
+// With the stick unplugged the ADC input is pulled to ground, which reads as
+// an open circuit through the stick
+static inline bool adc_code_connected(uint32_t code) {
+  return code >= ADC_TABLE_DISCONNECT_CODE;
+}
+
+// Wake the main loop to act on new state, by way of core 1's loop when the
+// interrupts run there
+static inline void notify_update(void) {
+#if JOYSTICK_CORE1
+  acquisition_updates++;
+#else
+  scheduler_post(SCHEDULER_EVENT_INPUT);
+#endif
+}
+
+// Run a new value for every axis through the filters, from the acquisition
+// interrupt. Axes without a bit in connected had no stick on them, so their
+// samples are meaningless and never reach the filters.
+static void filter_axes(const uint16_t values[NUM_AXES], uint8_t connected) {
+  PROFILE_SCOPE(PROFILE_FILTER_AXES);
+  uint32_t now_us = time_us_32();
+
+  const filter_config_t *config = pending_filter;
+  if (config) {
+    pending_filter = NULL;
+    for (int axis = 0; axis < NUM_AXES; axis++) {
+      filter_chain_init(&axis_filters[axis], config);
+    }
+  }
+
+  uint16_t filtered[NUM_AXES];
+  for (int axis = 0; axis < NUM_AXES; axis++) {
+    if (!(connected & 1u << axis)) {
+      filtered[axis] = JOYSTICK_AXIS_CENTRE;
+      continue;
+    }
+
+    // Start again from the first sample after a stick is plugged in, rather
+    // than averaging it in with whatever was there before
+    if (!(state->axes_connected & 1u << axis)) {
+      filter_chain_seed(&axis_filters[axis], values[axis]);
+    }
+    filtered[axis] = filter_chain_process(&axis_filters[axis], values[axis], now_us);
+  }
+
+  snapshot_write_begin(&snapshot);
+  for (int axis = 0; axis < NUM_AXES; axis++) {
+    *axis_values[axis] = filtered[axis];
+  }
+  state->axes_connected = connected;
+  state->sample_timestamp_us = now_us;
+  snapshot_write_end(&snapshot);
+  notify_update();
+}
+
+#if JOYSTICK_ADC_DMA
+// Converts the sum of 2^count_log2 ADC values into an axis value, interpolating between table
+// entries so that the extra resolution gained by averaging is kept
+static inline uint16_t convert_adc_sum_to_axis(uint32_t sum, uint8_t count_log2) {
+  PROFILE_SCOPE(PROFILE_ADC_CONVERT);
+  uint32_t code = sum >> count_log2;
+  int32_t fraction = sum & ((1u << count_log2) - 1);
+
+  if (code >= ADC_TABLE_SIZE - 1) {
+    return adc_to_axis_table[ADC_TABLE_SIZE - 1];
+  }
+
+  int32_t lower = adc_to_axis_table[code];
+  int32_t upper = adc_to_axis_table[code + 1];
+  return (uint16_t)(lower + (((upper - lower) * fraction) >> count_log2));
+}
+
+// Decimate a block of interleaved X, Y samples into one new value per axis
+static void process_adc_block(const uint16_t *block) {
+  uint32_t sum_x = 0;
+  uint32_t sum_y = 0;
+
+  for (int i = 0; i < ADC_DMA_BLOCK_SAMPLES; i += NUM_AXES) {
+    sum_x += block[i];
+    sum_y += block[i + 1];
+  }
+
+  uint16_t values[NUM_AXES] = {convert_adc_sum_to_axis(sum_x, ADC_DMA_SAMPLES_PER_AXIS_LOG2),
+                               convert_adc_sum_to_axis(sum_y, ADC_DMA_SAMPLES_PER_AXIS_LOG2)};
+  uint8_t connected = adc_code_connected(sum_x >> ADC_DMA_SAMPLES_PER_AXIS_LOG2) << 0 |
+                      adc_code_connected(sum_y >> ADC_DMA_SAMPLES_PER_AXIS_LOG2) << 1;
+  filter_axes(values, connected);
+}
+#endif
+
+#if JOYSTICK_AXIS_PIO
+// The charge time is proportional to the series and stick resistance
+// together, so the axis value is linear in the elapsed counts
+static inline uint16_t convert_rc_count_to_axis(uint32_t remaining) {
+  uint32_t elapsed = rc_window - remaining;
+
+  if (elapsed <= rc_offset) {
+    return 0;
+  }
+  uint32_t value = (uint32_t)(((uint64_t)(elapsed - rc_offset) * rc_scale) >> 16);
+  return value > JOYSTICK_AXIS_FULL_SCALE ? JOYSTICK_AXIS_FULL_SCALE : (uint16_t)value;
+}
+#endif
+
+// Record a button edge, both in the state and in the edge queue
+static void button_edge(uint8_t button, bool *level, bool pressed) {
+  button_edge_t edge = {button, pressed, time_us_32()};
+
+  snapshot_write_begin(&snapshot);
+  *level = pressed;
+  state->edge_timestamp_us = edge.timestamp_us;
+  snapshot_write_end(&snapshot);
+  capture_record(CAPTURE_BUTTON, button, pressed, edge.timestamp_us);
+  telemetry_record(CAPTURE_BUTTON, button, pressed, edge.timestamp_us);
+  edge_queue_push(&edge_queue, &edge);
+  notify_update();
+}
+
+// Mark a button as reported at the given level, and return the edge
+static bool report_edge(uint8_t button, uint32_t timestamp_us, button_edge_t *edge) {
+  debounce[button].reported = debounce[button].level;
+  debounce[button].reported_us = timestamp_us;
+
+  edge->button = button;
+  edge->pressed = debounce[button].level;
+  edge->timestamp_us = timestamp_us;
+  return true;
 }
 
 // Joystick interrupts
+#if JOYSTICK_BUTTON_PIO
+// Raised while any state machine has a debounced level waiting
+void button_pio_irq() {
+  for (uint8_t button = 0; button < JOYSTICK_NUM_BUTTONS; button++) {
+    while (!pio_sm_is_rx_fifo_empty(BUTTON_PIO, button)) {
+      bool pressed = !pio_sm_get(BUTTON_PIO, button);
+      if (pressed != *button_levels[button]) {
+        button_edge(button, button_levels[button], pressed);
+      }
+    }
+  }
+}
+#else
 void button_1_irq() {
   if (gpio_get_irq_event_mask(JOYSTICK_BUTTON_1_PIN) & BUTTON_PRESS_EVENT) {
     gpio_acknowledge_irq(JOYSTICK_BUTTON_1_PIN, BUTTON_PRESS_EVENT);
-    state.button_1 = true;
+    button_edge(0, &state->button_1, true);
   } else if (gpio_get_irq_event_mask(JOYSTICK_BUTTON_1_PIN) & BUTTON_RELEASE_EVENT) {
     gpio_acknowledge_irq(JOYSTICK_BUTTON_1_PIN, BUTTON_RELEASE_EVENT);
-    state.button_1 = false;
+    button_edge(0, &state->button_1, false);
   }
 }
 
 void button_2_irq() {
   if (gpio_get_irq_event_mask(JOYSTICK_BUTTON_2_PIN) & BUTTON_PRESS_EVENT) {
     gpio_acknowledge_irq(JOYSTICK_BUTTON_2_PIN, BUTTON_PRESS_EVENT);
-    state.button_2 = true;
+    button_edge(1, &state->button_2, true);
   } else if (gpio_get_irq_event_mask(JOYSTICK_BUTTON_2_PIN) & BUTTON_RELEASE_EVENT) {
     gpio_acknowledge_irq(JOYSTICK_BUTTON_2_PIN, BUTTON_RELEASE_EVENT);
-    state.button_2 = false;
+    button_edge(1, &state->button_2, false);
   }
 }
+#endif
+
+#if JOYSTICK_ADC_DMA
+void adc_dma_irq() {
+  PROFILE_SCOPE(PROFILE_ACQUISITION_IRQ);
+
+  for (int i = 0; i < ADC_DMA_NUM_BLOCKS; i++) {
+    int channel = adc_dma_channels[i];
 
+    // The next channel in the ring is already running, and this one's write
+    // address has wrapped back to the start of its block by itself, so
+    // there is nothing to do here but process the block it just filled
+    if (dma_channel_get_irq0_status(channel)) {
+      dma_channel_acknowledge_irq0(channel);
+      process_adc_block(adc_dma_blocks[i]);
+    }
+  }
+}
+#elif !JOYSTICK_AXIS_PIO
 void adc_irq() {
+  PROFILE_SCOPE(PROFILE_ACQUISITION_IRQ);
+
+  // A request left pending across a pause finds the FIFO already drained
+  if (adc_fifo_get_level() < NUM_AXES) {
+    return;
+  }
+
+#if JOYSTICK_SOF_SYNC
+  // One pair per trigger. Stop before the next conversion completes, or
+  // wait for it and throw it away, and start from X again next time.
+  adc_run(false);
+#endif
   uint16_t val_x = adc_fifo_get();
   uint16_t val_y = adc_fifo_get();
+#if JOYSTICK_SOF_SYNC
+  adc_fifo_drain();
+  adc_select_input(AXIS_X_ADC_INPUT);
+#endif
+
+  uint32_t now_us = time_us_32();
+  capture_record(CAPTURE_ADC, 0, val_x, now_us);
+  capture_record(CAPTURE_ADC, 1, val_y, now_us);
+  telemetry_record(CAPTURE_ADC, 0, val_x, now_us);
+  telemetry_record(CAPTURE_ADC, 1, val_y, now_us);
 
-  buffer_write(&x_buffer, convert_adc_value_to_resistance(val_x));
-  buffer_write(&y_buffer, convert_adc_value_to_resistance(val_y));
+  uint16_t values[NUM_AXES] = {convert_adc_value_to_axis(val_x), convert_adc_value_to_axis(val_y)};
+  filter_axes(values, adc_code_connected(val_x) << 0 | adc_code_connected(val_y) << 1);
 }
+#endif
 
-//-----------------------------------------------------------------------------
-// Public functions
-//-----------------------------------------------------------------------------
-void joystick_init() {
-  buffer_init(&x_buffer);
-  buffer_init(&y_buffer);
+#if JOYSTICK_AXIS_PIO
+// Raised by the state machines at the start of each measurement, by which
+// point DMA has collected the counts from the one before
+void rc_timer_irq() {
+  PROFILE_SCOPE(PROFILE_ACQUISITION_IRQ);
+
+  pio_interrupt_clear(RC_PIO, 0);
+
+  // Nothing has been measured yet on the first cycle
+  if (!rc_primed) {
+    rc_primed = true;
+    return;
+  }
+
+  uint16_t values[NUM_AXES];
+  uint8_t connected = 0;
+  for (int axis = 0; axis < NUM_AXES; axis++) {
+    // The state machine pushes 0 if the pin never went high within the
+    // window, with no stick to charge the capacitor through
+    uint32_t remaining = rc_counts[axis];
+    values[axis] = convert_rc_count_to_axis(remaining);
+    connected |= (remaining != 0) << axis;
+
+    // Each channel runs for 2^32 transfers, about 80 days, then needs a restart
+    if (!dma_channel_is_busy(rc_dma_channels[axis])) {
+      dma_channel_set_trans_count(rc_dma_channels[axis], UINT32_MAX, true);
+    }
+  }
+  filter_axes(values, connected);
+}
+
+static void rc_acquisition_init(void) {
+  // Counts for the capacitor to reach the threshold through 1 kohm
+  uint32_t counts_per_mhz = clock_get_hz(clk_sys) / RC_CYCLES_PER_COUNT / 1000000;
+  uint32_t counts_per_kohm = JOYSTICK_RC_CAPACITANCE_NF * counts_per_mhz * JOYSTICK_RC_THRESHOLD_PERMILLE / 1000;
+  uint32_t full_scale = JOYSTICK_AXIS_MAX_RESISTANCE / 1000 * counts_per_kohm;
+
+  rc_offset = JOYSTICK_RC_SERIES_RESISTANCE * counts_per_kohm / 1000;
+  rc_window = (rc_offset + full_scale) * RC_WINDOW_PERCENT / 100;
+  rc_scale = (uint32_t)(((uint64_t)JOYSTICK_AXIS_FULL_SCALE << 16) / full_scale);
+  rc_primed = false;
+
+  uint offset = pio_add_program(RC_PIO, &rc_timer_program);
+  for (int axis = 0; axis < NUM_AXES; axis++) {
+    uint sm = axis;
+    pio_sm_claim(RC_PIO, sm);
+    rc_timer_program_init(RC_PIO, sm, offset, axis_pins[axis], rc_window);
+
+    // Each push overwrites the axis' count, so the latest is always to hand
+    rc_dma_channels[axis] = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(rc_dma_channels[axis]);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(RC_PIO, sm, false));
+    dma_channel_configure(rc_dma_channels[axis], &config, &rc_counts[axis], &RC_PIO->rxf[sm], UINT32_MAX, true);
+  }
+
+  // Interrupt raised once per measurement, by all of the state machines together
+  pio_set_irq0_source_enabled(RC_PIO, pis_interrupt0, true);
+  irq_set_exclusive_handler(RC_PIO_IRQ, &rc_timer_irq);
+  irq_set_priority(RC_PIO_IRQ, ACQUISITION_IRQ_PRIORITY);
+  irq_set_enabled(RC_PIO_IRQ, true);
+
+  pio_enable_sm_mask_in_sync(RC_PIO, (1u << NUM_AXES) - 1);
+}
+#endif
+
+#if JOYSTICK_ADC_DMA
+static void adc_acquisition_init(void) {
+  // Run the ADC flat out, with every conversion raising a DMA request
+  adc_fifo_setup(true, true, 1, false, false);
+  adc_set_clkdiv(adc_clock_div);
+
+  for (int i = 0; i < ADC_DMA_NUM_BLOCKS; i++) {
+    adc_dma_channels[i] = dma_claim_unused_channel(true);
+  }
+
+  // Each channel fills its own block, then hands over to the next channel in
+  // the ring. Its write address wraps back to the start of the block in
+  // hardware, so the ring stays within its buffers however late the
+  // interrupt runs.
+  for (int i = 0; i < ADC_DMA_NUM_BLOCKS; i++) {
+    int channel = adc_dma_channels[i];
+    dma_channel_config config = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, DREQ_ADC);
+    channel_config_set_chain_to(&config, adc_dma_channels[(i + 1) % ADC_DMA_NUM_BLOCKS]);
+    channel_config_set_ring(&config, true, ADC_DMA_BLOCK_BYTES_LOG2);
+
+    dma_channel_configure(channel, &config, adc_dma_blocks[i], &adc_hw->fifo, ADC_DMA_BLOCK_SAMPLES, false);
+    dma_channel_set_irq0_enabled(channel, true);
+  }
 
+  // Interrupt raised once per completed block
+  irq_set_exclusive_handler(DMA_IRQ_0, &adc_dma_irq);
+  irq_set_priority(DMA_IRQ_0, ACQUISITION_IRQ_PRIORITY);
+  irq_set_enabled(DMA_IRQ_0, true);
+
+  dma_channel_start(adc_dma_channels[0]);
+  adc_run(true);
+}
+#elif !JOYSTICK_AXIS_PIO
+static void adc_acquisition_init(void) {
+  adc_fifo_setup(true, false, NUM_AXES, false, false);
+
+  // Add delay between ADC samples to prevent FIFO overun
+  adc_set_clkdiv(adc_clock_div);
+
+  // Interrupt raised every two ADC readings, allowing X and Y to update at the same time
+  irq_set_exclusive_handler(ADC_IRQ_FIFO, &adc_irq);
+  irq_set_priority(ADC_IRQ_FIFO, ACQUISITION_IRQ_PRIORITY);
+  adc_irq_set_enabled(true);
+  irq_set_enabled(ADC_IRQ_FIFO, true);
+
+  // Otherwise each pair waits for joystick_start_conversion()
+#if !JOYSTICK_SOF_SYNC
+  adc_run(true);
+#endif
+}
+#endif
+
+#if !JOYSTICK_AXIS_PIO
+// Fill the filters from a quick burst of one-shot conversions, before the
+// interrupts take over, so that the state holds the stick's position from
+// the start rather than from the first completed sample or block
+static void adc_prime_axes(void) {
+  static const uint8_t inputs[NUM_AXES] = {AXIS_X_ADC_INPUT, AXIS_Y_ADC_INPUT};
+  uint32_t sums[NUM_AXES] = {0};
+
+  for (int i = 0; i < PRIME_SAMPLES; i++) {
+    for (int axis = 0; axis < NUM_AXES; axis++) {
+      adc_select_input(inputs[axis]);
+      sums[axis] += adc_read();
+    }
+  }
+
+  uint16_t values[NUM_AXES];
+  uint8_t connected = 0;
+  for (int axis = 0; axis < NUM_AXES; axis++) {
+    uint16_t code = (sums[axis] + PRIME_SAMPLES / 2) / PRIME_SAMPLES;
+    values[axis] = convert_adc_value_to_axis(code);
+    connected |= adc_code_connected(code) << axis;
+  }
+  filter_axes(values, connected);
+}
+#endif
+
+#if JOYSTICK_BUTTON_PIO
+static void button_pio_init(void) {
+  uint16_t clock_div = clock_get_hz(clk_sys) / BUTTON_PIO_CLOCK_HZ;
+  uint offset = pio_add_program(BUTTON_PIO, &button_debounce_program);
+
+  for (uint8_t button = 0; button < JOYSTICK_NUM_BUTTONS; button++) {
+    gpio_init(button_pins[button]);
+    gpio_set_dir(button_pins[button], GPIO_IN);
+    gpio_pull_up(button_pins[button]);
+
+    pio_sm_claim(BUTTON_PIO, button);
+    button_debounce_program_init(BUTTON_PIO, button, offset, button_pins[button], clock_div,
+                                 JOYSTICK_BUTTON_DEBOUNCE_US);
+    pio_set_irq0_source_enabled(BUTTON_PIO, pis_sm0_rx_fifo_not_empty + button, true);
+  }
+
+  irq_set_exclusive_handler(BUTTON_PIO_IRQ, &button_pio_irq);
+  irq_set_priority(BUTTON_PIO_IRQ, ACQUISITION_IRQ_PRIORITY);
+  irq_set_enabled(BUTTON_PIO_IRQ, true);
+
+  // Each state machine pushes its button's starting level straight away
+  pio_enable_sm_mask_in_sync(BUTTON_PIO, (1u << JOYSTICK_NUM_BUTTONS) - 1);
+}
+#endif
+
+// Interrupts are handled by the core that enables them, so this runs on
+// whichever core does the sampling
+static void joystick_hw_init(void) {
   // Button setup
+#if JOYSTICK_BUTTON_PIO
+  button_pio_init();
+#else
   gpio_init(JOYSTICK_BUTTON_1_PIN);
   gpio_init(JOYSTICK_BUTTON_2_PIN);
 
@@ -104,37 +578,209 @@ void joystick_init() {
 
   gpio_set_irq_enabled(JOYSTICK_BUTTON_1_PIN, BUTTON_PRESS_EVENT | BUTTON_RELEASE_EVENT, true);
   gpio_set_irq_enabled(JOYSTICK_BUTTON_2_PIN, BUTTON_PRESS_EVENT | BUTTON_RELEASE_EVENT, true);
+  irq_set_priority(IO_IRQ_BANK0, ACQUISITION_IRQ_PRIORITY);
   irq_set_enabled(IO_IRQ_BANK0, true);
+#endif
 
   // Axis setup
+#if JOYSTICK_AXIS_PIO
+  rc_acquisition_init();
+#else
   adc_init();
   adc_gpio_init(JOYSTICK_AXIS_X_PIN);
   adc_gpio_init(JOYSTICK_AXIS_Y_PIN);
+  adc_prime_axes();
 
   // Start with X axis, round robin sampling of both X and Y
   adc_select_input(AXIS_X_ADC_INPUT);
   adc_set_round_robin(1 << AXIS_X_ADC_INPUT | 1 << AXIS_Y_ADC_INPUT);
-  adc_fifo_setup(true, false, NUM_AXES, false, false);
+  adc_acquisition_init();
+#endif
+}
 
-  // Add delay between ADC samples to prevent FIFO overun
-  adc_set_clkdiv(ADC_CLOCK_DIV);
+#if JOYSTICK_CORE1
+// Core 1 owns all of the acquisition interrupts, and wakes core 0 each time
+// one of them changes the state
+static void core1_main(void) {
+  // Lets core 0 park this core while it writes to flash
+  multicore_lockout_victim_init();
+  profile_core_init();
+  joystick_hw_init();
+  uint32_t published = acquisition_updates;
 
-  // Interrupt raised every two ADC readings, allowing X and Y to update at the same time
-  irq_set_exclusive_handler(ADC_IRQ_FIFO, &adc_irq);
-  adc_irq_set_enabled(true);
-  irq_set_enabled(ADC_IRQ_FIFO, true);
+  while (1) {
+    uint32_t updates = acquisition_updates;
+    if (updates != published) {
+      published = updates;
+      scheduler_post(SCHEDULER_EVENT_INPUT);
+    }
+
+    if (background_task) {
+      background_task();
+    }
+
+    // Sleep until the next interrupt, unless one arrived in the meantime
+    if (acquisition_updates == published) {
+      __wfe();
+    }
+  }
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+void joystick_init() {
+  for (int axis = 0; axis < NUM_AXES; axis++) {
+    filter_chain_init(&axis_filters[axis], &default_filter);
+  }
+  pending_filter = NULL;
+  edge_queue_init(&edge_queue);
+  memset(debounce, 0, sizeof(debounce));
+
+  // Axes read as centred until the first sample finds a stick on them. No
+  // interrupts are writing the state yet.
+  snapshot_init(&snapshot, &(joystick_state_t){0});
+  for (int axis = 0; axis < NUM_AXES; axis++) {
+    *axis_values[axis] = JOYSTICK_AXIS_CENTRE;
+  }
+
+#if JOYSTICK_CORE1
+  multicore_launch_core1(&core1_main);
+#else
+  joystick_hw_init();
+#endif
+
+  // Only return once the state holds a real sample, so that the first report
+  // is never the placeholder above. The ADC is primed during setup, while
+  // RC-timed axes take one measurement window.
+  while (!snapshot.sequence) {
+    tight_loop_contents();
+  }
+}
+
+void joystick_set_background_task(joystick_task_t task) {
+#if JOYSTICK_CORE1
+  background_task = task;
+#endif
+}
+
+bool joystick_next_edge(button_edge_t *edge) {
+  button_edge_t raw;
+
+  // Edges in order, skipping any that land within the hold-off of the last
+  // one reported for the same button
+  while (edge_queue_pop(&edge_queue, &raw)) {
+    debounce[raw.button].level = raw.pressed;
+    debounce[raw.button].level_us = raw.timestamp_us;
+
+    if (raw.pressed != debounce[raw.button].reported &&
+        raw.timestamp_us - debounce[raw.button].reported_us >= EDGE_HOLD_OFF_US) {
+      return report_edge(raw.button, raw.timestamp_us, edge);
+    }
+  }
+
+  uint32_t now_us = time_us_32();
+  uint32_t dropped = edge_queue.dropped;
+
+  for (uint8_t button = 0; button < JOYSTICK_NUM_BUTTONS; button++) {
+    // Once a button has been quiet for the hold-off, its pin has settled. That
+    // catches any level the queue missed, at start-up or when it overflowed.
+    // The state machines report every settled level themselves.
+    if (dropped != edges_dropped ||
+        (!JOYSTICK_BUTTON_PIO && now_us - debounce[button].level_us >= JOYSTICK_BUTTON_DEBOUNCE_US)) {
+      bool pressed = !gpio_get(button_pins[button]);
+      if (pressed != debounce[button].level) {
+        debounce[button].level = pressed;
+        debounce[button].level_us = now_us;
+      }
+    }
+
+    // Report the level a bounce settled on, once the hold-off is over
+    if (debounce[button].level != debounce[button].reported &&
+        now_us - debounce[button].reported_us >= EDGE_HOLD_OFF_US) {
+      return report_edge(button, debounce[button].level_us, edge);
+    }
+  }
+  edges_dropped = dropped;
+
+  return false;
+}
+
+void joystick_set_filter(const filter_config_t *config) {
+  pending_filter = config ? config : &default_filter;
+}
+
+void joystick_set_adc_clock_div(uint16_t clock_div) {
+#if JOYSTICK_ADC_MIN_CLOCK_DIV > 0
+  if (clock_div < JOYSTICK_ADC_MIN_CLOCK_DIV) {
+    clock_div = JOYSTICK_ADC_MIN_CLOCK_DIV;
+  }
+#endif
+  adc_clock_div = clock_div;
+
+  // A single register write, so safe while the ADC is free-running on
+  // either core. Frame-synced pairs always convert back to back.
+#if !JOYSTICK_AXIS_PIO && !JOYSTICK_SOF_SYNC
+  adc_set_clkdiv(clock_div);
+#endif
+}
+
+uint16_t joystick_adc_clock_div(void) {
+  return adc_clock_div;
+}
+
+uint32_t joystick_edges_dropped(void) {
+  return edge_queue.dropped;
+}
+
+void joystick_start_conversion(void) {
+#if JOYSTICK_SOF_SYNC
+  if (!acquisition_paused) {
+    adc_run(true);
+  }
+#endif
+}
+
+void joystick_pause_acquisition(void) {
+#if !JOYSTICK_AXIS_PIO
+  acquisition_paused = true;
+  adc_run(false);
+#if JOYSTICK_ADC_DMA
+  // The partly filled block is dropped, along with any interrupt the abort
+  // raises for it
+  for (int i = 0; i < ADC_DMA_NUM_BLOCKS; i++) {
+    dma_channel_abort(adc_dma_channels[i]);
+    dma_channel_acknowledge_irq0(adc_dma_channels[i]);
+  }
+#endif
+#endif
+}
+
+void joystick_resume_acquisition(void) {
+#if !JOYSTICK_AXIS_PIO
+  // Round robin carries on from wherever the last conversion left it, so
+  // start again from X with nothing left over
+  adc_fifo_drain();
+  adc_select_input(AXIS_X_ADC_INPUT);
+#if JOYSTICK_ADC_DMA
+  for (int i = 0; i < ADC_DMA_NUM_BLOCKS; i++) {
+    dma_channel_set_write_addr(adc_dma_channels[i], adc_dma_blocks[i], false);
+  }
+  dma_channel_start(adc_dma_channels[0]);
+#endif
+  acquisition_paused = false;
+#if !JOYSTICK_SOF_SYNC
   adc_run(true);
+#endif
+#endif
 }
 
 void joystick_read(joystick_state_t *state_buffer) {
-  state.x_axis = buffer_average(&x_buffer);
-  state.y_axis = buffer_average(&y_buffer);
-
-  memcpy(state_buffer, &state, sizeof(state));
+  snapshot_read(&snapshot, state_buffer);
+  state_buffer->timestamp_us = time_us_32();
 }
 
-int8_t joystick_rescale_axis(float value) {
-  float scaling = ((255.0 / (2.0 * (float)JOYSTICK_AXIS_CENTRE_RESISTANCE)));
-  float axis = (value - (float)JOYSTICK_AXIS_CENTRE_RESISTANCE) * scaling;
-  return (int8_t)round(axis);
+float joystick_axis_resistance(uint16_t value) {
+  return value * ((float)JOYSTICK_AXIS_MAX_RESISTANCE / JOYSTICK_AXIS_FULL_SCALE);
 }
@@ -7,6 +7,8 @@
 #ifndef __JOYSTICK_H__
 #define __JOYSTICK_H__
 
+#include "edge_queue.h"
+#include "filter.h"
 #include "stdint.h"
 #include "stdbool.h"
 
@@ -15,6 +17,121 @@
 //-----------------------------------------------------------------------------
 
 #define JOYSTICK_AXIS_CENTRE_RESISTANCE 55000
+#define JOYSTICK_AXIS_MAX_RESISTANCE (2 * JOYSTICK_AXIS_CENTRE_RESISTANCE)
+
+// Axis values are unsigned integers, with 0 - JOYSTICK_AXIS_FULL_SCALE covering
+// 0 - JOYSTICK_AXIS_MAX_RESISTANCE ohms of stick resistance
+#define JOYSTICK_AXIS_FULL_SCALE 0xFFFF
+
+// Value reported for an axis with no stick plugged into it
+#define JOYSTICK_AXIS_CENTRE (JOYSTICK_AXIS_FULL_SCALE / 2)
+
+// Set to 1 to drain the ADC by DMA at its full 500 kS/s and filter in blocks,
+// rather than taking an interrupt for every X, Y pair of conversions
+#ifndef JOYSTICK_ADC_DMA
+#define JOYSTICK_ADC_DMA 0
+#endif
+
+// Set to 1 to time the RC charge on all four gameport axes with PIO, as the
+// original game cards did, rather than reading two axes through the ADC.
+// Each axis then needs a capacitor from its pin to ground, charged through
+// the stick and a series resistor from 3.3 V.
+#ifndef JOYSTICK_AXIS_PIO
+#define JOYSTICK_AXIS_PIO 0
+#endif
+
+#if JOYSTICK_AXIS_PIO && JOYSTICK_ADC_DMA
+#error "JOYSTICK_AXIS_PIO and JOYSTICK_ADC_DMA are alternative acquisition modes"
+#endif
+
+#if JOYSTICK_AXIS_PIO
+#define JOYSTICK_NUM_AXES 4
+#else
+#define JOYSTICK_NUM_AXES 2
+#endif
+
+// RC timing circuit, per axis
+#ifndef JOYSTICK_RC_CAPACITANCE_NF
+#define JOYSTICK_RC_CAPACITANCE_NF 10
+#endif
+#ifndef JOYSTICK_RC_SERIES_RESISTANCE
+#define JOYSTICK_RC_SERIES_RESISTANCE 2200  // Limits the discharge current with the stick at zero
+#endif
+
+// Time constants for the capacitor to charge from 0 V to the pin's input
+// high threshold, in thousandths: ln(1 / (1 - 0.62)) for about 2.05 V at 3.3 V
+#ifndef JOYSTICK_RC_THRESHOLD_PERMILLE
+#define JOYSTICK_RC_THRESHOLD_PERMILLE 968
+#endif
+
+// Set to 1 to take a single X, Y pair of conversions in each USB frame, timed
+// by sof_sync.c to finish just before the host next polls, rather than
+// free-running the ADC. Needs USB_HID_FAST_POLL.
+#ifndef JOYSTICK_SOF_SYNC
+#define JOYSTICK_SOF_SYNC 0
+#endif
+
+#if JOYSTICK_SOF_SYNC && (JOYSTICK_ADC_DMA || JOYSTICK_AXIS_PIO || JOYSTICK_CORE1)
+#error "JOYSTICK_SOF_SYNC triggers the interrupt-driven ADC path from core 0"
+#endif
+
+// ADC conversions start every (1 + JOYSTICK_ADC_CLOCK_DIV) cycles of the 48 MHz ADC clock,
+// with a minimum of 96 cycles per conversion
+#if JOYSTICK_ADC_DMA || JOYSTICK_SOF_SYNC
+#define JOYSTICK_ADC_CLOCK_DIV 0
+#else
+#define JOYSTICK_ADC_CLOCK_DIV 65535  // Slow enough for the FIFO interrupt to keep up
+#endif
+
+// Fastest clock divider that can be set at run time. An interrupt for every
+// pair of conversions needs at least 100 us between them.
+#if JOYSTICK_ADC_DMA || JOYSTICK_SOF_SYNC
+#define JOYSTICK_ADC_MIN_CLOCK_DIV 0
+#else
+#define JOYSTICK_ADC_MIN_CLOCK_DIV 2399
+#endif
+
+// Set to 1 to run sampling and filtering on core 1, with core 0 reading the
+// joystick state as it goes
+#ifndef JOYSTICK_CORE1
+#define JOYSTICK_CORE1 0
+#endif
+
+// Filter stages each axis passes through, see filter.h. The default is a
+// moving average over about the same time span in either acquisition mode.
+#ifndef JOYSTICK_FILTER_STAGES
+#if JOYSTICK_ADC_DMA
+#define JOYSTICK_FILTER_STAGES FILTER_STAGE_BOXCAR(4)
+#else
+#define JOYSTICK_FILTER_STAGES FILTER_STAGE_BOXCAR(10)
+#endif
+#endif
+
+// Edges on a button within this long of the last reported one are treated as
+// contact bounce. The level it settles at is reported once the hold-off ends.
+#ifndef JOYSTICK_BUTTON_DEBOUNCE_US
+#define JOYSTICK_BUTTON_DEBOUNCE_US 5000
+#endif
+
+// Set to 1 to sample and debounce the buttons with PIO, so the CPU is only
+// interrupted once per debounced edge rather than for every bounce. Reads
+// all four gameport buttons.
+#ifndef JOYSTICK_BUTTON_PIO
+#define JOYSTICK_BUTTON_PIO 0
+#endif
+
+#if JOYSTICK_BUTTON_PIO
+#define JOYSTICK_NUM_BUTTONS 4
+#else
+#define JOYSTICK_NUM_BUTTONS 2
+#endif
+
+#if JOYSTICK_SOF_SYNC
+#define JOYSTICK_ADC_SAMPLE_PERIOD_NS 1000000  // One pair per frame
+#else
+#define JOYSTICK_ADC_SAMPLE_PERIOD_NS \
+  ((JOYSTICK_ADC_CLOCK_DIV < 95 ? 96 : JOYSTICK_ADC_CLOCK_DIV + 1) * 1000 / 48)
+#endif
 
 //-----------------------------------------------------------------------------
 // Public types
@@ -23,21 +140,69 @@
 typedef struct {
   bool button_1;
   bool button_2;
-  float x_axis;
-  float y_axis;
+#if JOYSTICK_NUM_BUTTONS > 2
+  bool button_3;
+  bool button_4;
+#endif
+  uint16_t x_axis;
+  uint16_t y_axis;
+#if JOYSTICK_NUM_AXES > 2
+  uint16_t x2_axis;
+  uint16_t y2_axis;
+#endif
+  uint8_t axes_connected;        // Bit per axis, set while the last sample found a stick on it
+  uint32_t timestamp_us;         // When the state was last read
+  uint32_t sample_timestamp_us;  // When the newest axis sample was taken
+  uint32_t edge_timestamp_us;    // When a button last changed state
 } joystick_state_t;
 
+typedef void (*joystick_task_t)(void);
+
 //-----------------------------------------------------------------------------
 // Public functions
 //-----------------------------------------------------------------------------
 
-// Initialise the joystick module and begin monitoring state
+// Initialise the joystick module and begin monitoring state. Returns once the
+// state holds a first sample of every axis, so it can be reported straight away.
 void joystick_init();
 
-// Populate a struct with the current state of the joystick
+// Set a task for core 1 to run in between publishing snapshots. Only used when
+// JOYSTICK_CORE1 is set, and must be called before joystick_init()
+void joystick_set_background_task(joystick_task_t task);
+
+// Replace the axis filter chain from the next sample on, clearing its history.
+// The config must stay valid until then. NULL restores the built-in chain.
+void joystick_set_filter(const filter_config_t *config);
+
+// Change the ADC sample rate while running, see JOYSTICK_ADC_CLOCK_DIV. Not
+// used with RC-timed axes or JOYSTICK_SOF_SYNC.
+void joystick_set_adc_clock_div(uint16_t clock_div);
+uint16_t joystick_adc_clock_div(void);
+
+// Button edges lost so far because the edge queue was full
+uint32_t joystick_edges_dropped(void);
+
+// Start a conversion of each axis, with JOYSTICK_SOF_SYNC. Safe from any
+// context on core 0.
+void joystick_start_conversion(void);
+
+// Stop the ADC and its DMA ring, for a stretch with interrupts masked such as
+// a flash write, and start them again from a clean X, Y pair afterwards. The
+// state holds its last values in between. RC-timed axes need neither, as
+// their state machines only ever overwrite one count per axis.
+void joystick_pause_acquisition(void);
+void joystick_resume_acquisition(void);
+
+// Populate a struct with the current state of the joystick, with buttons,
+// axes and timestamps all from the same instant. Never masks interrupts, and
+// can be called from either core but not from an interrupt handler.
 void joystick_read(joystick_state_t *state_buffer);
 
-// Convert a joystick axis value to an 8-bit integer
-int8_t joystick_rescale_axis(float value);
+// Take the next debounced button edge, oldest first, returning false if there
+// are none. Single consumer, on core 0.
+bool joystick_next_edge(button_edge_t *edge);
+
+// Convert a joystick axis value back into ohms, for debug output only
+float joystick_axis_resistance(uint16_t value);
 
 #endif // __JOYSTICK_H__
@@ -0,0 +1,76 @@
+//-----------------------------------------------------------------------------
+// On-device histograms of input latency through each stage of the firmware
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "latency.h"
+
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static latency_histogram_t histograms[LATENCY_NUM_STAGES];
+
+static const char *const stage_names[LATENCY_NUM_STAGES] = {
+    "sample->read",
+    "read->report",
+    "edge->report",
+    "report->complete",
+    "sample->complete",
+    "edge->complete",
+};
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static inline uint32_t bucket_index(uint32_t latency_us) {
+  if (latency_us == 0) {
+    return 0;
+  }
+
+  uint32_t index = 32 - __builtin_clz(latency_us);
+  return index < LATENCY_NUM_BUCKETS ? index : LATENCY_NUM_BUCKETS - 1;
+}
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+#if LATENCY_INSTRUMENTATION
+void latency_record(latency_stage_t stage, uint32_t latency_us) {
+  latency_histogram_t *histogram = &histograms[stage];
+
+  if (histogram->count == 0 || latency_us < histogram->min_us) {
+    histogram->min_us = latency_us;
+  }
+  if (latency_us > histogram->max_us) {
+    histogram->max_us = latency_us;
+  }
+
+  histogram->count++;
+  histogram->total_us += latency_us;
+  histogram->buckets[bucket_index(latency_us)]++;
+}
+#endif
+
+// Recording happens in the USB task on core 0, so a copy taken there is
+// always whole. From core 1 it may count a sample its buckets do not have yet.
+void latency_read(latency_stage_t stage, latency_histogram_t *histogram) {
+  memcpy(histogram, &histograms[stage], sizeof(*histogram));
+}
+
+void latency_reset(void) {
+  memset(histograms, 0, sizeof(histograms));
+}
+
+uint32_t latency_bucket_min_us(uint32_t bucket) {
+  return bucket ? 1u << (bucket - 1) : 0;
+}
+
+const char *latency_stage_name(latency_stage_t stage) {
+  return stage < LATENCY_NUM_STAGES ? stage_names[stage] : "";
+}
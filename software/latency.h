@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+// On-device histograms of input latency through each stage of the firmware
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+// Set to 0 to compile out all latency recording
+#ifndef LATENCY_INSTRUMENTATION
+#define LATENCY_INSTRUMENTATION 1
+#endif
+
+// Bucket 0 counts latencies of 0 us, bucket n counts 2^(n-1) to 2^n - 1 us,
+// and the last bucket also holds everything longer
+#define LATENCY_NUM_BUCKETS 16
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+typedef enum {
+  LATENCY_SAMPLE_TO_READ,       // ADC sample -> joystick_read()
+  LATENCY_READ_TO_REPORT,       // joystick_read() -> tud_hid_report()
+  LATENCY_EDGE_TO_REPORT,       // Button edge IRQ -> tud_hid_report()
+  LATENCY_REPORT_TO_COMPLETE,   // tud_hid_report() -> report collected by the host
+  LATENCY_SAMPLE_TO_COMPLETE,   // Total for axis movement
+  LATENCY_EDGE_TO_COMPLETE,     // Total for button presses
+  LATENCY_NUM_STAGES
+} latency_stage_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint32_t buckets[LATENCY_NUM_BUCKETS];
+} latency_histogram_t;
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+#if LATENCY_INSTRUMENTATION
+// Add a measurement to a stage's histogram. Must only be called from the USB task.
+void latency_record(latency_stage_t stage, uint32_t latency_us);
+#else
+static inline void latency_record(latency_stage_t stage, uint32_t latency_us) {}
+#endif
+
+// Copy out the histogram for a stage
+void latency_read(latency_stage_t stage, latency_histogram_t *histogram);
+
+// Clear all histograms
+void latency_reset(void);
+
+// Shortest latency a bucket counts
+uint32_t latency_bucket_min_us(uint32_t bucket);
+
+// Short name of a stage, for display
+const char *latency_stage_name(latency_stage_t stage);
+
+#endif  // __LATENCY_H__
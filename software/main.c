@@ -7,8 +7,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "calibration.h"
+#include "capture.h"
+#include "debug_log.h"
 #include "joystick.h"
+#include "latency.h"
+#include "pico/stdlib.h"
 #include "pico/time.h"
+#include "profile.h"
+#include "scheduler.h"
+#include "sof_sync.h"
+#include "telemetry.h"
 #include "tusb.h"
 #include "usb_hid.h"
 
@@ -22,9 +31,10 @@
 // Private variables
 //-----------------------------------------------------------------------------
 
-static joystick_state_t joystick = {0, 0, 0, 0};
+static joystick_state_t joystick = {0};
 static struct repeating_timer debug_print_timer;
-static bool debug_print_output = false;
+static volatile bool debug_print_output = false;
+static bool first_report_logged = false;
 
 //-----------------------------------------------------------------------------
 // Private functions
@@ -32,22 +42,111 @@ static bool debug_print_output = false;
 
 static bool debug_print_timer_callback(struct repeating_timer *t) {
   debug_print_output = true;
+  scheduler_post(SCHEDULER_EVENT_DEBUG_PRINT);
+  return true;
 }
 
 static void debug_print_init(void) {
   add_repeating_timer_ms(DEBUG_PRINT_INTERVAL_MS, &debug_print_timer_callback, NULL, &debug_print_timer);
 }
 
+#if LATENCY_INSTRUMENTATION
+static void latency_print(void) {
+  latency_histogram_t histogram;
+
+  for (int stage = 0; stage < LATENCY_NUM_STAGES; stage++) {
+    latency_read(stage, &histogram);
+    if (histogram.count) {
+      DEBUG_LOG(LATENCY, debug_log_string(latency_stage_name(stage)), histogram.count, histogram.min_us,
+                histogram.total_us / histogram.count, histogram.max_us);
+
+      // Then the shape of the histogram, one line per bucket that has anything in it
+      for (uint32_t bucket = 0; bucket < LATENCY_NUM_BUCKETS; bucket++) {
+        if (histogram.buckets[bucket]) {
+          DEBUG_LOG(LATENCY_BUCKET, latency_bucket_min_us(bucket), histogram.buckets[bucket]);
+        }
+      }
+    }
+  }
+}
+#endif
+
+#if JOYSTICK_PROFILE
+static void profile_print(void) {
+  profile_stats_t stats;
+  uint32_t cycles_per_us = profile_counter_hz() / 1000000;
+
+  for (int probe = 0; probe < PROFILE_NUM_PROBES; probe++) {
+    profile_read(probe, &stats);
+    if (stats.count) {
+      DEBUG_LOG(PROFILE, debug_log_string(profile_probe_name(probe)), stats.count, stats.min_cycles,
+                stats.total_cycles / stats.count, stats.max_cycles, stats.max_cycles / cycles_per_us);
+    }
+  }
+}
+#endif
+
+#if JOYSTICK_CAPTURE
+// Print each chunk of the capture as hex, for tools/capture_from_log.py to
+// turn back into a capture file
+static void capture_print(const void *data, uint32_t len, void *context) {
+  const uint8_t *bytes = data;
+
+  printf("capture: ");
+  for (uint32_t i = 0; i < len; i++) {
+    printf("%02x", bytes[i]);
+  }
+  printf("\n");
+}
+#endif
+
 static void debug_print_task(void) {
+#if JOYSTICK_CAPTURE
+  // Sending 'c' over the UART dumps the capture. This blocks for several
+  // seconds, so expect USB reports to stall while it runs.
+  if (getchar_timeout_us(0) == 'c') {
+    debug_log_flush();
+    capture_dump(&capture_print, NULL);
+  }
+#endif
+
   if (debug_print_output) {
     debug_print_output = false;
     joystick_read(&joystick);
 
-    printf("Raw joystick values: X: %f Y: %f B1: %d B2: %d\n",
-           joystick.x_axis, joystick.y_axis, joystick.button_1, joystick.button_2);
-
-    printf("Rescaled joystick axes: X: %d Y: %d \n",
-           joystick_rescale_axis(joystick.x_axis), joystick_rescale_axis(joystick.y_axis));
+    DEBUG_LOG(RAW_AXES, debug_log_float(joystick_axis_resistance(joystick.x_axis)),
+              debug_log_float(joystick_axis_resistance(joystick.y_axis)), joystick.button_1, joystick.button_2);
+#if JOYSTICK_NUM_BUTTONS > 2
+    DEBUG_LOG(EXTRA_BUTTONS, joystick.button_3, joystick.button_4);
+#endif
+
+    DEBUG_LOG(CALIBRATED_AXES, calibration_apply(CALIBRATION_AXIS_X, joystick.x_axis),
+              calibration_apply(CALIBRATION_AXIS_Y, joystick.y_axis),
+              debug_log_string(calibration_in_progress() ? " (calibrating)" : ""));
+
+#if JOYSTICK_NUM_AXES > 2
+    DEBUG_LOG(SECOND_STICK, debug_log_float(joystick_axis_resistance(joystick.x2_axis)),
+              debug_log_float(joystick_axis_resistance(joystick.y2_axis)),
+              calibration_apply(CALIBRATION_AXIS_X2, joystick.x2_axis),
+              calibration_apply(CALIBRATION_AXIS_Y2, joystick.y2_axis));
+#endif
+
+    if (!first_report_logged && usb_hid_first_report_us()) {
+      first_report_logged = true;
+      DEBUG_LOG(FIRST_REPORT, usb_hid_first_report_us());
+    }
+
+    scheduler_stats_t stats;
+    scheduler_read_stats(&stats);
+    DEBUG_LOG(SCHEDULER_STATS, stats.busy_permille / 10, stats.busy_permille % 10,
+              stats.wakeups_per_window * 1000000ull / SCHEDULER_STATS_WINDOW_US);
+
+#if LATENCY_INSTRUMENTATION
+    latency_print();
+#endif
+#if JOYSTICK_PROFILE
+    profile_print();
+#endif
   }
 }
 
@@ -56,20 +155,57 @@ static void debug_print_task(void) {
 //-----------------------------------------------------------------------------
 
 int main(void) {
+  profile_core_init();
   stdio_init_all();
-  tusb_init();
+  debug_log_init();
+
+  // Before core 1 starts, as the log takes records from one context at a time
+  DEBUG_LOG(BANNER);
+  DEBUG_LOG(COPYRIGHT);
+
+  // With sampling on core 1, build the debug output there too. Core 0 only
+  // drains the log to the UART.
+#if JOYSTICK_CORE1
+  joystick_set_background_task(&debug_print_task);
+#endif
+
+  // The axes are primed before USB starts, so the first report the host can
+  // collect after enumeration already carries the stick's position
   joystick_init();
+  tusb_init();
   usb_init();
+  sof_sync_init();
   debug_print_init();
 
-  printf("Raspberry Pi Pico gameport joystick USB adapter\n");
-  printf("Copyright 2023 Alan Reed (areed.me)\n");
-  printf("\n");
-
+  // Work is driven by events posted from interrupts, and the core sleeps
+  // whenever there is none
+  scheduler_init();
   while (1) {
-    tud_task();
-    usb_task();
-    debug_print_task();
+    // TinyUSB queues its own events from the USB interrupt
+    if (tud_task_event_ready()) {
+      tud_task();
+    }
+
+    uint32_t events = scheduler_take();
+    if (events & (1u << SCHEDULER_EVENT_INPUT | 1u << SCHEDULER_EVENT_REPORT)) {
+      usb_task();
+    }
+    // After the HID report, so streaming never holds it up
+    if (events & 1u << SCHEDULER_EVENT_TELEMETRY) {
+      telemetry_task();
+    }
+    if (events & 1u << SCHEDULER_EVENT_DEBUG_LOG) {
+      debug_log_task();
+    }
+#if !JOYSTICK_CORE1
+    if (events & 1u << SCHEDULER_EVENT_DEBUG_PRINT) {
+      debug_print_task();
+    }
+#endif
+
+    if (!tud_task_event_ready()) {
+      scheduler_sleep();
+    }
   }
 
   return 0;
@@ -14,9 +14,15 @@
 // Gameport joystick connections
 #define JOYSTICK_BUTTON_1_PIN 16 // Gameport pin 2
 #define JOYSTICK_BUTTON_2_PIN 17 // Gameport pin 7
+#define JOYSTICK_BUTTON_3_PIN 18 // Gameport pin 10, only read with JOYSTICK_BUTTON_PIO
+#define JOYSTICK_BUTTON_4_PIN 19 // Gameport pin 14, only read with JOYSTICK_BUTTON_PIO
 #define JOYSTICK_AXIS_X_PIN 26   // Gameport pin 3
 #define JOYSTICK_AXIS_Y_PIN 27   // Gameport pin 6
 
+// Second stick, only read with JOYSTICK_AXIS_PIO
+#define JOYSTICK_AXIS_X2_PIN 28  // Gameport pin 11
+#define JOYSTICK_AXIS_Y2_PIN 22  // Gameport pin 13
+
 // Pi Pico built-in LED
 #define LED_PIN 25
 
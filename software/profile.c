@@ -0,0 +1,100 @@
+//-----------------------------------------------------------------------------
+// On-target cycle counts for each stage of the firmware, from the SysTick
+// counter of whichever core runs the stage
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "profile.h"
+
+#include <string.h>
+
+#if JOYSTICK_PROFILE
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#endif
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static profile_stats_t stats[PROFILE_NUM_PROBES];
+
+#if JOYSTICK_PROFILE
+// Cycles between two back-to-back counter reads, taken off every measurement
+static uint32_t overhead_cycles = 0;
+#endif
+
+static const char *const probe_names[PROFILE_NUM_PROBES] = {
+    "acquisition_irq",
+    "adc_convert",
+    "filter_axes",
+    "buffer_write",
+    "buffer_average",
+    "calibration",
+    "usb_task",
+};
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+#if JOYSTICK_PROFILE
+void profile_record(profile_probe_t probe, uint32_t start) {
+  uint32_t cycles = (start - systick_hw->cvr) & PROFILE_COUNTER_MASK;
+  cycles = cycles > overhead_cycles ? cycles - overhead_cycles : 0;
+
+  profile_stats_t *probe_stats = &stats[probe];
+  if (probe_stats->count == 0 || cycles < probe_stats->min_cycles) {
+    probe_stats->min_cycles = cycles;
+  }
+  if (cycles > probe_stats->max_cycles) {
+    probe_stats->max_cycles = cycles;
+  }
+  probe_stats->count++;
+  probe_stats->total_cycles += cycles;
+}
+#endif
+
+void profile_core_init(void) {
+#if JOYSTICK_PROFILE
+  systick_hw->rvr = PROFILE_COUNTER_MASK;
+  systick_hw->cvr = 0;
+  // Count processor clock cycles, with no interrupt
+  systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+
+  // Time an empty probe, keeping the shortest of a few tries
+  uint32_t shortest = PROFILE_COUNTER_MASK;
+  for (int i = 0; i < 8; i++) {
+    uint32_t start = profile_now();
+    uint32_t cycles = (start - profile_now()) & PROFILE_COUNTER_MASK;
+    if (cycles < shortest) {
+      shortest = cycles;
+    }
+  }
+  overhead_cycles = shortest;
+#endif
+}
+
+// Probes are recorded from interrupts and either core without a lock. A copy
+// taken part way through an update may have the new count without its cycles,
+// which only nudges the mean until the next read.
+void profile_read(profile_probe_t probe, profile_stats_t *probe_stats) {
+  memcpy(probe_stats, &stats[probe], sizeof(*probe_stats));
+}
+
+void profile_reset(void) {
+  memset(stats, 0, sizeof(stats));
+}
+
+uint32_t profile_counter_hz(void) {
+#if JOYSTICK_PROFILE
+  return clock_get_hz(clk_sys);
+#else
+  return 0;
+#endif
+}
+
+const char *profile_probe_name(profile_probe_t probe) {
+  return probe < PROFILE_NUM_PROBES ? probe_names[probe] : "";
+}
@@ -0,0 +1,98 @@
+//-----------------------------------------------------------------------------
+// On-target cycle counts for each stage of the firmware, from the SysTick
+// counter of whichever core runs the stage
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+// Set to 1 to time every probe. Probes compile out completely otherwise.
+#ifndef JOYSTICK_PROFILE
+#define JOYSTICK_PROFILE 0
+#endif
+
+// SysTick is a 24-bit down counter, so a single probe can time up to 2^24
+// cycles, about 134 ms at 125 MHz
+#define PROFILE_COUNTER_MASK 0x00FFFFFF
+
+#define PROFILE_NAME_LEN 16
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+typedef enum {
+  PROFILE_ACQUISITION_IRQ,   // adc_irq(), adc_dma_irq() or rc_timer_irq()
+  PROFILE_ADC_CONVERT,       // convert_adc_value_to_axis()
+  PROFILE_FILTER_AXES,       // Every axis through its filter chain
+  PROFILE_BUFFER_WRITE,      // buffer_write()
+  PROFILE_BUFFER_AVERAGE,    // buffer_average()
+  PROFILE_CALIBRATION_APPLY, // calibration_apply()
+  PROFILE_USB_TASK,          // usb_task()
+  PROFILE_NUM_PROBES
+} profile_probe_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t min_cycles;
+  uint32_t max_cycles;
+  uint64_t total_cycles;
+} profile_stats_t;
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+#if JOYSTICK_PROFILE
+#include "hardware/structs/systick.h"
+
+typedef struct {
+  profile_probe_t probe;
+  uint32_t start;
+} profile_scope_t;
+
+static inline uint32_t profile_now(void) {
+  return systick_hw->cvr;
+}
+
+// Add a measurement that started at the given counter value. A probe recorded
+// from more than one core or interrupt level may occasionally lose an update.
+void profile_record(profile_probe_t probe, uint32_t start);
+
+static inline void profile_scope_end(profile_scope_t *scope) {
+  profile_record(scope->probe, scope->start);
+}
+
+// Time from here to the end of the enclosing block
+#define PROFILE_SCOPE(probe) \
+  profile_scope_t profile_scope_##probe __attribute__((cleanup(profile_scope_end))) = {(probe), profile_now()}
+#else
+#define PROFILE_SCOPE(probe)
+#endif
+
+// Start the cycle counter on the calling core. Call on each core that runs
+// probes, before any of them.
+void profile_core_init(void);
+
+// Copy out the stats for a probe, in cycles
+void profile_read(profile_probe_t probe, profile_stats_t *stats);
+
+// Clear all stats
+void profile_reset(void);
+
+// Counter frequency, to convert cycles to time, or 0 when profiling is disabled
+uint32_t profile_counter_hz(void);
+
+// Short name of a probe, for display
+const char *profile_probe_name(profile_probe_t probe);
+
+#endif  // __PROFILE_H__
@@ -0,0 +1,96 @@
+//-----------------------------------------------------------------------------
+// Event-driven main loop support: interrupts post events, and the loop
+// sleeps with __wfe() whenever none are pending
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "scheduler.h"
+
+#include "hardware/structs/scb.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+// One byte per event, so posting is a single store and needs no locking,
+// even from the other core
+static volatile bool pending[SCHEDULER_NUM_EVENTS];
+
+static uint32_t window_start_us;
+static uint32_t window_sleep_us;
+static uint32_t window_wakeups;
+static scheduler_stats_t stats;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static bool any_pending(void) {
+  for (int event = 0; event < SCHEDULER_NUM_EVENTS; event++) {
+    if (pending[event]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+void scheduler_init(void) {
+  // With SEVONPEND, an interrupt becoming pending sets the event register, so
+  // one that fires between checking for work and sleeping is not missed
+  scb_hw->scr |= M0PLUS_SCR_SEVONPEND_BITS;
+
+  window_start_us = time_us_32();
+}
+
+void scheduler_post(scheduler_event_t event) {
+  pending[event] = true;
+  __sev();
+}
+
+// Each event is cleared before its handler runs, so a post that races with
+// this is either taken now or left pending for the next pass
+uint32_t scheduler_take(void) {
+  uint32_t events = 0;
+
+  for (int event = 0; event < SCHEDULER_NUM_EVENTS; event++) {
+    if (pending[event]) {
+      pending[event] = false;
+      events |= 1u << event;
+    }
+  }
+  return events;
+}
+
+void scheduler_sleep(void) {
+  if (any_pending()) {
+    return;
+  }
+
+  uint32_t sleep_start_us = time_us_32();
+  __wfe();
+  uint32_t now_us = time_us_32();
+
+  window_sleep_us += now_us - sleep_start_us;
+  window_wakeups++;
+
+  uint32_t elapsed_us = now_us - window_start_us;
+  if (elapsed_us >= SCHEDULER_STATS_WINDOW_US) {
+    stats.busy_permille = (uint32_t)((uint64_t)(elapsed_us - window_sleep_us) * 1000 / elapsed_us);
+    stats.wakeups_per_window = window_wakeups;
+
+    window_start_us = now_us;
+    window_sleep_us = 0;
+    window_wakeups = 0;
+  }
+}
+
+void scheduler_read_stats(scheduler_stats_t *out) {
+  *out = stats;
+}
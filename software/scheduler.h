@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+// Event-driven main loop support: interrupts post events, and the loop
+// sleeps with __wfe() whenever none are pending
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+// Utilisation and wake-up counts cover this long a window
+#define SCHEDULER_STATS_WINDOW_US 1000000
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+// Work items for the main loop. Posting an event that is already pending
+// merges the two, so each handler must deal with everything outstanding.
+typedef enum {
+  SCHEDULER_EVENT_INPUT,        // New joystick state or button edge
+  SCHEDULER_EVENT_REPORT,       // HID report timer tick, or the endpoint has been freed
+  SCHEDULER_EVENT_DEBUG_PRINT,  // Debug print timer tick
+  SCHEDULER_EVENT_TELEMETRY,    // A telemetry block is ready to send
+  SCHEDULER_EVENT_DEBUG_LOG,    // Debug log records are waiting for the UART
+  SCHEDULER_NUM_EVENTS
+} scheduler_event_t;
+
+typedef struct {
+  uint32_t busy_permille;     // Share of the last window spent awake
+  uint32_t wakeups_per_window;
+} scheduler_stats_t;
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+// Make any interrupt wake the core from __wfe(), even one that arrives just
+// before it sleeps
+void scheduler_init(void);
+
+// Post an event from an interrupt, or from either core
+void scheduler_post(scheduler_event_t event);
+
+// Take and clear all pending events, as a mask of 1 << scheduler_event_t
+uint32_t scheduler_take(void);
+
+// Sleep until the next interrupt or event, unless an event is already pending
+void scheduler_sleep(void);
+
+// Utilisation over the last complete window
+void scheduler_read_stats(scheduler_stats_t *stats);
+
+#endif  // __SCHEDULER_H__
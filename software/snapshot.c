@@ -0,0 +1,34 @@
+//-----------------------------------------------------------------------------
+// Sequence-locked joystick state, for consistent snapshots without masking
+// interrupts
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "snapshot.h"
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+void snapshot_init(snapshot_t *snapshot, const joystick_state_t *initial) {
+  snapshot->sequence = 0;
+  snapshot->state = *initial;
+}
+
+void snapshot_read(const snapshot_t *snapshot, joystick_state_t *state) {
+  uint32_t sequence;
+
+  do {
+    // Wait out a write in progress on the other core
+    do {
+      sequence = snapshot->sequence;
+    } while (sequence & 1);
+    __dmb();
+
+    *state = snapshot->state;
+
+    // The copy must complete before the sequence is checked again
+    __dmb();
+  } while (snapshot->sequence != sequence);
+}
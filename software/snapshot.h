@@ -0,0 +1,52 @@
+//-----------------------------------------------------------------------------
+// Sequence-locked joystick state, for consistent snapshots without masking
+// interrupts
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include "hardware/sync.h"
+#include "joystick.h"
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+// The state is only written from the acquisition interrupts, which must all
+// run on one core at one priority so that no write can interrupt another.
+// Readers copy it without blocking them, and try again if a write landed
+// part way through the copy. Any number of readers, on either core.
+typedef struct {
+  volatile uint32_t sequence;  // Odd while a write is in progress
+  joystick_state_t state;
+} snapshot_t;
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+// Start from the given state
+void snapshot_init(snapshot_t *snapshot, const joystick_state_t *initial);
+
+// Writer side: bracket every change to snapshot->state. Keep the stores in
+// between short, as readers spin until they are done.
+static inline void snapshot_write_begin(snapshot_t *snapshot) {
+  snapshot->sequence++;
+  __dmb();
+}
+
+static inline void snapshot_write_end(snapshot_t *snapshot) {
+  __dmb();
+  snapshot->sequence++;
+}
+
+// Reader side: copy out a state that no write overlapped. Must not be called
+// from an interrupt that can preempt the writers on their own core.
+void snapshot_read(const snapshot_t *snapshot, joystick_state_t *state);
+
+#endif  // __SNAPSHOT_H__
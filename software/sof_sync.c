@@ -0,0 +1,92 @@
+//-----------------------------------------------------------------------------
+// Sampling locked to the USB start of frame, so each report is built from a
+// sample taken just before the host polls for it
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "sof_sync.h"
+
+#include "pico/time.h"
+#include "tusb.h"
+#include "usb_hid.h"
+
+#if JOYSTICK_SOF_SYNC
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#if !USB_HID_FAST_POLL
+#error "JOYSTICK_SOF_SYNC needs USB_HID_FAST_POLL, so that the host polls in every frame"
+#endif
+
+#define FRAME_NUMBER_MASK 0x7FF  // Frame numbers are 11 bits
+
+// A callback later than the estimate mostly measures how long the main loop
+// took to get to it, so the estimate only moves 1/2^n of the way towards it
+#define LATE_SLEW_SHIFT 4
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+static bool locked = false;
+static uint32_t frame_number;
+static uint32_t frame_start_us;  // Estimated start of frame_number
+static alarm_id_t sample_alarm = 0;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static int64_t sample_alarm_callback(alarm_id_t id, void *user_data) {
+  sample_alarm = 0;
+  joystick_start_conversion();
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+void sof_sync_init(void) {
+  locked = false;
+  tud_sof_cb_enable(true);
+}
+
+//-----------------------------------------------------------------------------
+// Optional device callback declared in TinyUSB's usbd.h
+//-----------------------------------------------------------------------------
+
+// Invoked from tud_task() for every start of frame, so always some time after
+// the frame actually started. The earliest callbacks are the closest to the
+// true start, and the estimate follows those straight away.
+void tud_sof_cb(uint32_t frame_count) {
+  uint32_t now_us = time_us_32();
+  uint32_t frames = (frame_count - frame_number) & FRAME_NUMBER_MASK;
+  int32_t late_us = (int32_t)(now_us - (frame_start_us + frames * SOF_SYNC_FRAME_US));
+
+  if (!locked || late_us < 0 || late_us >= SOF_SYNC_FRAME_US / 2) {
+    frame_start_us = now_us;
+    locked = true;
+  } else {
+    frame_start_us += frames * SOF_SYNC_FRAME_US + (late_us >> LATE_SLEW_SHIFT);
+  }
+  frame_number = frame_count;
+
+  // Sample for the report the host will collect in the next frame. If the
+  // callback is already too late for that, sample straight away.
+  if (sample_alarm > 0) {
+    cancel_alarm(sample_alarm);
+  }
+  int32_t delay_us = (int32_t)(frame_start_us + SOF_SYNC_FRAME_US - SOF_SYNC_LEAD_US - time_us_32());
+  if (delay_us <= 0) {
+    sample_alarm = 0;
+    joystick_start_conversion();
+  } else {
+    sample_alarm = add_alarm_in_us(delay_us, &sample_alarm_callback, NULL, true);
+  }
+}
+
+#endif  // JOYSTICK_SOF_SYNC
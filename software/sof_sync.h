@@ -0,0 +1,38 @@
+//-----------------------------------------------------------------------------
+// Sampling locked to the USB start of frame, so each report is built from a
+// sample taken just before the host polls for it
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __SOF_SYNC_H__
+#define __SOF_SYNC_H__
+
+#include "joystick.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+#define SOF_SYNC_FRAME_US 1000  // Full-speed frame
+
+// How long before the next frame starts to sample the axes. This covers the
+// conversions, the filters and queuing the report, with room to spare for
+// the main loop to be busy with something else.
+#ifndef SOF_SYNC_LEAD_US
+#define SOF_SYNC_LEAD_US 100
+#endif
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+#if JOYSTICK_SOF_SYNC
+// Start taking SOF callbacks from TinyUSB, after tusb_init()
+void sof_sync_init(void);
+#else
+static inline void sof_sync_init(void) {}
+#endif
+
+#endif  // __SOF_SYNC_H__
@@ -0,0 +1,214 @@
+//-----------------------------------------------------------------------------
+// Raw input stream over a vendor-specific USB bulk interface, alongside the
+// HID joystick
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#include "telemetry.h"
+
+#include "hardware/sync.h"
+#include "joystick.h"
+#include "pico/time.h"
+#include "scheduler.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"  // Class driver interface, needs tusb.h first
+
+#if JOYSTICK_TELEMETRY
+
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+
+#define BLOCK_INDEX_MASK (TELEMETRY_NUM_BLOCKS - 1)
+
+_Static_assert((TELEMETRY_NUM_BLOCKS & BLOCK_INDEX_MASK) == 0, "TELEMETRY_NUM_BLOCKS must be a power of two");
+
+#if JOYSTICK_ADC_DMA || JOYSTICK_AXIS_PIO
+#error "Telemetry streams raw codes from adc_irq, so needs the interrupt-driven ADC path"
+#endif
+
+//-----------------------------------------------------------------------------
+// Private variables
+//-----------------------------------------------------------------------------
+
+// Ring of blocks. The acquisition interrupts fill them in order, and each
+// full block is handed to the USB controller as it stands.
+static capture_record_t blocks[TELEMETRY_NUM_BLOCKS][TELEMETRY_BLOCK_RECORDS];
+static volatile uint32_t blocks_written = 0;   // Total blocks filled, by the interrupts
+static volatile uint32_t blocks_released = 0;  // Total blocks free to refill, by the USB task
+static uint32_t block_fill = 0;                // Records in the block being filled
+static uint32_t next_send = 0;                 // Next block to transmit
+
+static volatile bool streaming = false;
+static volatile bool restart = false;  // Set to make the interrupts start a fresh block
+static volatile uint32_t dropped = 0;
+
+static uint8_t rhport_in_use;
+static uint8_t endpoint_in = 0;  // 0 while the interface is closed
+static bool in_flight = false;
+
+static telemetry_info_t info;
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+static void start_streaming(void) {
+  joystick_state_t state;
+  joystick_read(&state);
+
+  info.header.magic = CAPTURE_MAGIC;
+  info.header.version = CAPTURE_VERSION;
+  info.header.record_size = sizeof(capture_record_t);
+  info.header.flags = capture_flags();
+  info.header.record_count = 0;
+  info.header.end_us = time_us_32();
+  info.header.filter_id = capture_filter_id();
+  capture_read_settings(&info.header.settings);
+  info.buttons = (state.button_1 ? 1 << 0 : 0) | (state.button_2 ? 1 << 1 : 0);
+#if JOYSTICK_NUM_BUTTONS > 2
+  info.buttons |= (state.button_3 ? 1 << 2 : 0) | (state.button_4 ? 1 << 3 : 0);
+#endif
+  info.num_buttons = JOYSTICK_NUM_BUTTONS;
+
+  // Anything already queued predates the request. A block the interrupts
+  // finish just after this may still go out, and the host can drop its
+  // records by their timestamps.
+  dropped = 0;
+  restart = true;
+  __dmb();
+  streaming = true;
+  next_send = blocks_written;
+  if (!in_flight) {
+    blocks_released = next_send;
+  }
+}
+
+static void start_transfer(void) {
+  if (!endpoint_in || in_flight || next_send == blocks_written) {
+    return;
+  }
+
+  in_flight = true;
+  usbd_edpt_xfer(rhport_in_use, endpoint_in, (uint8_t *)blocks[next_send & BLOCK_INDEX_MASK], sizeof(blocks[0]));
+  next_send++;
+}
+
+//-----------------------------------------------------------------------------
+// Class driver, registered with TinyUSB through usbd_app_driver_get_cb()
+//-----------------------------------------------------------------------------
+
+static void telemetry_driver_init(void) {}
+
+static void telemetry_driver_reset(uint8_t rhport) {
+  streaming = false;
+  endpoint_in = 0;
+  in_flight = false;
+  next_send = blocks_written;
+  blocks_released = next_send;
+}
+
+static uint16_t telemetry_driver_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16_t max_len) {
+  uint16_t len = TELEMETRY_DESC_LEN;
+  TU_VERIFY(desc_itf->bInterfaceClass == TUSB_CLASS_VENDOR_SPECIFIC && desc_itf->bNumEndpoints == 1, 0);
+  TU_VERIFY(max_len >= len, 0);
+
+  tusb_desc_endpoint_t const *desc_ep = (tusb_desc_endpoint_t const *)tu_desc_next(desc_itf);
+  TU_ASSERT(usbd_edpt_open(rhport, desc_ep), 0);
+
+  rhport_in_use = rhport;
+  endpoint_in = desc_ep->bEndpointAddress;
+  return len;
+}
+
+static bool telemetry_driver_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const *request) {
+  if (stage != CONTROL_STAGE_SETUP) {
+    return true;
+  }
+  TU_VERIFY(request->bmRequestType_bit.type == TUSB_REQ_TYPE_VENDOR);
+
+  switch (request->bRequest) {
+    case TELEMETRY_REQUEST_START:
+      start_streaming();
+      return tud_control_status(rhport, request);
+
+    case TELEMETRY_REQUEST_STOP:
+      streaming = false;
+      return tud_control_status(rhport, request);
+
+    case TELEMETRY_REQUEST_INFO:
+      info.dropped = dropped;
+      return tud_control_xfer(rhport, request, &info, sizeof(info));
+
+    default:
+      return false;
+  }
+}
+
+static bool telemetry_driver_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  // Every block up to the next one to send is finished with, including any
+  // skipped by a restart while this one was in flight
+  in_flight = false;
+  blocks_released = next_send;
+  start_transfer();
+  return true;
+}
+
+static const usbd_class_driver_t telemetry_driver = {
+#if CFG_TUSB_DEBUG >= 2
+    .name = "TELEMETRY",
+#endif
+    .init = telemetry_driver_init,
+    .reset = telemetry_driver_reset,
+    .open = telemetry_driver_open,
+    .control_xfer_cb = telemetry_driver_control_xfer_cb,
+    .xfer_cb = telemetry_driver_xfer_cb,
+    .sof = NULL,
+};
+
+usbd_class_driver_t const *usbd_app_driver_get_cb(uint8_t *driver_count) {
+  *driver_count = 1;
+  return &telemetry_driver;
+}
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+void telemetry_record(capture_type_t type, uint8_t channel, uint16_t value, uint32_t timestamp_us) {
+  if (!streaming) {
+    return;
+  }
+  if (restart) {
+    restart = false;
+    block_fill = 0;
+  }
+
+  // The block being filled may still be queued or in flight from the last
+  // time round the ring
+  uint32_t written = blocks_written;
+  if (written - blocks_released >= TELEMETRY_NUM_BLOCKS) {
+    dropped++;
+    return;
+  }
+
+  capture_record_t *record = &blocks[written & BLOCK_INDEX_MASK][block_fill];
+  record->timestamp_us = timestamp_us;
+  record->value = value;
+  record->type = type;
+  record->channel = channel;
+
+  if (++block_fill == TELEMETRY_BLOCK_RECORDS) {
+    block_fill = 0;
+    __dmb();
+    blocks_written = written + 1;
+    scheduler_post(SCHEDULER_EVENT_TELEMETRY);
+  }
+}
+
+void telemetry_task(void) {
+  start_transfer();
+}
+
+#endif
@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+// Raw input stream over a vendor-specific USB bulk interface, alongside the
+// HID joystick
+//
+// Copyright 2023 Alan Reed (areed.me)
+//-----------------------------------------------------------------------------
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include "capture.h"
+#include "stdbool.h"
+#include "stdint.h"
+
+//-----------------------------------------------------------------------------
+// Public constants
+//-----------------------------------------------------------------------------
+
+// Set to 1 to add a second USB interface that streams every ADC code and
+// button edge as it is acquired, in the capture record format
+#ifndef JOYSTICK_TELEMETRY
+#define JOYSTICK_TELEMETRY 0
+#endif
+
+// Records go out in whole blocks, each one a single bulk transfer sent
+// straight from the ring. Each conversion is a record, one every
+// JOYSTICK_ADC_SAMPLE_PERIOD_NS, so at the default rate of about 732 a second
+// a block fills in about 87 ms.
+#define TELEMETRY_BLOCK_RECORDS 64
+#define TELEMETRY_NUM_BLOCKS 8  // Must be a power of two
+
+// Interface descriptor for a single bulk IN endpoint
+#define TELEMETRY_DESC_LEN (9 + 7)
+#define TUD_TELEMETRY_DESCRIPTOR(_itfnum, _stridx, _epin, _epsize)                                     \
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 1, TUSB_CLASS_VENDOR_SPECIFIC, 0x00, 0x00, _stridx,              \
+  7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
+
+// Vendor requests to the telemetry interface
+#define TELEMETRY_REQUEST_START 1  // Start streaming, dropping anything queued
+#define TELEMETRY_REQUEST_STOP 2   // Stop streaming
+#define TELEMETRY_REQUEST_INFO 3   // Read a telemetry_info_t
+
+//-----------------------------------------------------------------------------
+// Public types
+//-----------------------------------------------------------------------------
+
+typedef struct __attribute__((packed)) {
+  capture_header_t header;  // No records, and end_us is when streaming last started
+  uint8_t buttons;          // Button levels when streaming last started, 1 when pressed
+  uint8_t num_buttons;
+  uint32_t dropped;         // Records dropped since then, because the host fell behind
+} telemetry_info_t;
+
+//-----------------------------------------------------------------------------
+// Public functions
+//-----------------------------------------------------------------------------
+
+#if JOYSTICK_TELEMETRY
+// Add a record to the stream. Must only be called from the acquisition
+// interrupts.
+void telemetry_record(capture_type_t type, uint8_t channel, uint16_t value, uint32_t timestamp_us);
+
+// Send any completed blocks. Call from the main loop on
+// SCHEDULER_EVENT_TELEMETRY.
+void telemetry_task(void);
+#else
+static inline void telemetry_record(capture_type_t type, uint8_t channel, uint16_t value, uint32_t timestamp_us) {}
+static inline void telemetry_task(void) {}
+#endif
+
+#endif  // __TELEMETRY_H__
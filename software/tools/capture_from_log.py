@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# Extracts a capture dumped over the debug UART into a binary capture file,
+# for host/replay.c
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+import argparse
+import struct
+import sys
+
+PREFIX = "capture: "
+MAGIC = 0x5041434A
+HEADER = struct.Struct("<IHHIIII4H20H")  # capture_header_t
+RECORD = struct.Struct("<IHBB")          # capture_record_t
+TYPE_NAMES = {0: "adc", 1: "button"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("log", help="UART log containing a capture dump")
+    parser.add_argument("output", help="capture file to write")
+    parser.add_argument("--list", action="store_true", help="also print every record")
+    args = parser.parse_args()
+
+    data = bytearray()
+    with open(args.log, errors="replace") as log:
+        for line in log:
+            line = line.strip()
+            if line.startswith(PREFIX):
+                data += bytes.fromhex(line[len(PREFIX):])
+
+    if len(data) < HEADER.size:
+        sys.exit("no capture found in " + args.log)
+
+    magic, version, record_size, flags, count, end_us = HEADER.unpack_from(data)[:6]
+    if magic != MAGIC or record_size != RECORD.size:
+        sys.exit("capture header is corrupt")
+
+    expected = HEADER.size + count * RECORD.size
+    if len(data) < expected:
+        sys.exit("capture is truncated: %d of %d bytes" % (len(data), expected))
+
+    with open(args.output, "wb") as output:
+        output.write(data[:expected])
+
+    records = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size) for i in range(count)]
+    span_us = (records[-1][0] - records[0][0]) & 0xFFFFFFFF if records else 0
+    print("version %d, flags %#x, %d records over %.3f s" % (version, flags, count, span_us / 1e6))
+
+    if args.list:
+        for timestamp_us, value, record_type, channel in records:
+            print("%10u %-6s %d %5d" % (timestamp_us, TYPE_NAMES.get(record_type, "?"), channel, value))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# Formats the binary debug log from the UART (see debug_log.h), passing any
+# plain text through as it is. Reads a saved log, or a serial port with
+# pyserial.
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SYNC = 0xA5  # DEBUG_LOG_SYNC
+HEADER = struct.Struct("<BBI")  # Format ID, argument count, timestamp
+MAX_ARGS = 8  # DEBUG_LOG_MAX_ARGS
+FORMATS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "debug_log_formats.h")
+CONVERSION = re.compile(r"%[-+ #0]*\d*(?:\.\d+)?([a-zA-Z%])")
+
+
+def load_formats(path):
+    with open(path) as f:
+        return [format for _, format in re.findall(r'^DEBUG_LOG_FORMAT\((\w+),\s*"(.*)"\)', f.read(), re.M)]
+
+
+class Elf:
+    """Reads string constants out of the loaded sections of a 32-bit ELF file"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1:
+            sys.exit("%s is not a 32-bit ELF file" % path)
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from("<IIIIII", self.data, shoff + i * shentsize)
+            if sh_type == 1 and flags & 2:  # SHT_PROGBITS, SHF_ALLOC
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                return self.data[start:self.data.index(b"\0", start)].decode(errors="replace")
+        return "<%#x>" % address
+
+
+def format_record(formats, elf, format_id, args):
+    if format_id >= len(formats):
+        return "<unknown format %d: %s>" % (format_id, " ".join("%#x" % arg for arg in args))
+    format = formats[format_id]
+    values = []
+    conversions = [c for c in CONVERSION.findall(format) if c != "%"]
+    if len(conversions) != len(args):
+        return "<format %d expects %d arguments, got %d>" % (format_id, len(conversions), len(args))
+    for conversion, arg in zip(conversions, args):
+        if conversion in "di":
+            values.append(arg - (1 << 32) if arg & 0x80000000 else arg)
+        elif conversion in "fFeEgG":
+            values.append(struct.unpack("<f", struct.pack("<I", arg))[0])
+        elif conversion == "s":
+            values.append(elf.string(arg) if elf else "<%#x>" % arg)
+        else:
+            values.append(arg)
+    return format % tuple(values)
+
+
+def decode(read, out, formats, elf, timestamps):
+    """Decode bytes from read(n) until it returns nothing"""
+    buffer = bytearray()
+
+    def take(n):
+        while len(buffer) < n:
+            data = read(max(n - len(buffer), 1))
+            if not data:
+                return None
+            buffer.extend(data)
+        data = bytes(buffer[:n])
+        del buffer[:n]
+        return data
+
+    while True:
+        byte = take(1)
+        if byte is None:
+            return
+        if byte[0] != SYNC:
+            out.write(byte.decode("latin-1"))
+            continue
+
+        header = take(HEADER.size)
+        if header is None:
+            return
+        format_id, num_args, timestamp_us = HEADER.unpack(header)
+        if num_args > MAX_ARGS:
+            # Not a record after all, so resynchronise on the next byte
+            buffer[:0] = header
+            continue
+        payload = take(num_args * 4)
+        if payload is None:
+            return
+        args = struct.unpack("<%dI" % num_args, payload)
+
+        line = format_record(formats, elf, format_id, args)
+        if timestamps:
+            line = "[%12.6f] %s" % (timestamp_us / 1e6, line)
+        out.write(line + "\n")
+        out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("input", help="saved UART log, or a serial port such as /dev/ttyUSB0")
+    parser.add_argument("--baud", type=int, default=115200, help="serial port speed")
+    parser.add_argument("--elf", help="firmware ELF file, to show %%s arguments")
+    parser.add_argument("--formats", default=FORMATS_H, help="debug_log_formats.h the firmware was built with")
+    parser.add_argument("--no-timestamps", dest="timestamps", action="store_false",
+                        help="leave out the device time of each record")
+    args = parser.parse_args()
+
+    formats = load_formats(args.formats)
+    elf = Elf(args.elf) if args.elf else None
+
+    if args.input.startswith("/dev/"):
+        import serial
+        port = serial.Serial(args.input, args.baud)
+        read = port.read
+    else:
+        read = open(args.input, "rb").read
+
+    try:
+        decode(read, sys.stdout, formats, elf, args.timestamps)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,17 @@
+#-----------------------------------------------------------------------------
+# USB IDs of the joystick adapter, read from device_spec.json for the tools
+# that look for it
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+import json
+import os
+
+SPEC = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "device_spec.json")
+
+with open(SPEC) as _f:
+    _device = json.load(_f)["device"]
+
+USB_VID = int(_device["vid"], 0)
+USB_PID = int(_device["pid"], 0)
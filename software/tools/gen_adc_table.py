@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# Generates the ADC code -> joystick axis lookup table used by joystick.c
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+import argparse
+import os
+
+ADC_BITS = 12
+AXIS_FULL_SCALE = 0xFFFF
+
+HEADER_TEMPLATE = """\
+//-----------------------------------------------------------------------------
+// ADC code to joystick axis lookup table
+//
+// Generated by tools/gen_adc_table.py - do not edit
+//-----------------------------------------------------------------------------
+
+#ifndef __ADC_TABLE_H__
+#define __ADC_TABLE_H__
+
+#include <stdint.h>
+
+#define ADC_TABLE_SIZE {size}
+#define ADC_TABLE_FIXED_RESISTANCE {fixed_ohms}
+#define ADC_TABLE_MAX_RESISTANCE {max_ohms}
+
+// Codes below this read as more than {disconnect_percent}% of ADC_TABLE_MAX_RESISTANCE,
+// which only an open circuit gives, so no stick is plugged in
+#define ADC_TABLE_DISCONNECT_CODE {disconnect_code}
+
+// Axis value for each 12-bit ADC code, scaled so that 0 - {full_scale} covers
+// 0 - ADC_TABLE_MAX_RESISTANCE ohms of stick resistance
+extern const uint16_t adc_to_axis_table[ADC_TABLE_SIZE];
+
+#endif  // __ADC_TABLE_H__
+"""
+
+SOURCE_TEMPLATE = """\
+//-----------------------------------------------------------------------------
+// ADC code to joystick axis lookup table
+//
+// Generated by tools/gen_adc_table.py - do not edit
+//-----------------------------------------------------------------------------
+
+#include "adc_table.h"
+
+const uint16_t adc_to_axis_table[ADC_TABLE_SIZE] = {{
+{values}
+}};
+"""
+
+
+# The stick is the top half of a voltage divider against a fixed resistor to
+# ground, with the ADC referenced to the same supply that drives the divider:
+#   code / 2^N = R_fixed / (R_fixed + R_stick)
+#   R_stick    = R_fixed * (2^N - code) / code
+def axis_value(code, fixed_ohms, max_ohms):
+    if code == 0:
+        return AXIS_FULL_SCALE
+
+    counts = 1 << ADC_BITS
+    # Rounded integer form of R_stick * AXIS_FULL_SCALE / max_ohms
+    numerator = fixed_ohms * (counts - code) * AXIS_FULL_SCALE
+    denominator = code * max_ohms
+    value = (2 * numerator + denominator) // (2 * denominator)
+    return min(value, AXIS_FULL_SCALE)
+
+
+# Lowest code for a stick resistance of at most the given percentage of full
+# deflection, from the same divider
+def disconnect_code(fixed_ohms, max_ohms, percent):
+    counts = 1 << ADC_BITS
+    limit_ohms = max_ohms * percent // 100
+    return (counts * fixed_ohms + fixed_ohms + limit_ohms - 1) // (fixed_ohms + limit_ohms)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--fixed-ohms", type=int, required=True)
+    parser.add_argument("--max-ohms", type=int, required=True)
+    parser.add_argument("--disconnect-percent", type=int, default=150)
+    parser.add_argument("--output-dir", required=True)
+    args = parser.parse_args()
+
+    size = 1 << ADC_BITS
+    values = [axis_value(code, args.fixed_ohms, args.max_ohms) for code in range(size)]
+    rows = []
+    for i in range(0, size, 16):
+        rows.append("  " + ", ".join("%5d" % v for v in values[i:i + 16]) + ",")
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    with open(os.path.join(args.output_dir, "adc_table.h"), "w") as f:
+        f.write(HEADER_TEMPLATE.format(size=size, fixed_ohms=args.fixed_ohms,
+                                       max_ohms=args.max_ohms, full_scale=AXIS_FULL_SCALE,
+                                       disconnect_percent=args.disconnect_percent,
+                                       disconnect_code=disconnect_code(args.fixed_ohms, args.max_ohms,
+                                                                       args.disconnect_percent)))
+    with open(os.path.join(args.output_dir, "adc_table.c"), "w") as f:
+        f.write(SOURCE_TEMPLATE.format(values="\n".join(rows)))
+
+
+if __name__ == "__main__":
+    main()
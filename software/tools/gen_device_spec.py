@@ -0,0 +1,405 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# Generates the HID report descriptor, report struct, packing code and string
+# descriptors from device_spec.json, as device_spec.h/.c and device_spec_report.h
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+import argparse
+import itertools
+import json
+import os
+import sys
+
+USAGE_PAGE_DESKTOP = 0x01
+USAGE_PAGE_BUTTON = 0x09
+USAGE_JOYSTICK = 0x04
+USAGE_HAT_SWITCH = 0x39
+AXIS_USAGES = {"X": 0x30, "Y": 0x31, "Z": 0x32, "RX": 0x33, "RY": 0x34, "RZ": 0x35,
+               "SLIDER": 0x36, "DIAL": 0x37, "WHEEL": 0x38}
+
+# Short item tags, as (tag << 4) | (type << 2)
+INPUT = 0x80
+COLLECTION = 0xA0
+END_COLLECTION = 0xC0
+USAGE_PAGE = 0x04
+LOGICAL_MIN = 0x14
+LOGICAL_MAX = 0x24
+PHYSICAL_MIN = 0x34
+PHYSICAL_MAX = 0x44
+UNIT = 0x64
+REPORT_SIZE = 0x74
+REPORT_ID = 0x84
+REPORT_COUNT = 0x94
+USAGE = 0x08
+USAGE_MIN = 0x18
+USAGE_MAX = 0x28
+
+DATA_VAR_ABS = 0x02
+DATA_VAR_ABS_NULL = 0x42
+CONSTANT = 0x01
+UNIT_DEGREES = 0x14  # English rotation, degrees
+
+HAT_BITS = 4
+HAT_DEGREES = 315
+
+HEADER_TEMPLATE = """\
+//-----------------------------------------------------------------------------
+// USB device layout, from device_spec.json
+//
+// Generated by tools/gen_device_spec.py - do not edit
+//-----------------------------------------------------------------------------
+
+#ifndef __DEVICE_SPEC_H__
+#define __DEVICE_SPEC_H__
+
+#include <stdint.h>
+
+#define DEVICE_SPEC_VID {vid:#06x}
+#define DEVICE_SPEC_PID {pid:#06x}
+#define DEVICE_SPEC_RELEASE {release:#06x}
+#define DEVICE_SPEC_REPORT_ID {report_id}
+
+// String descriptor indices
+{string_indices}
+#define DEVICE_SPEC_NUM_STRINGS {num_strings}
+
+// Pre-encoded string descriptors, ready to return from tud_descriptor_string_cb()
+extern const uint16_t *const device_spec_strings[DEVICE_SPEC_NUM_STRINGS];
+
+#endif  // __DEVICE_SPEC_H__
+"""
+
+REPORT_HEADER_TEMPLATE = """\
+//-----------------------------------------------------------------------------
+// HID report layout, from device_spec.json, for each combination of build
+// options it lists
+//
+// Generated by tools/gen_device_spec.py - do not edit
+//-----------------------------------------------------------------------------
+
+#ifndef __DEVICE_SPEC_REPORT_H__
+#define __DEVICE_SPEC_REPORT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "device_spec.h"
+
+// Include after the headers defining {options}
+
+{variants}
+
+#endif  // __DEVICE_SPEC_REPORT_H__
+"""
+
+SOURCE_TEMPLATE = """\
+//-----------------------------------------------------------------------------
+// USB string descriptors, from device_spec.json
+//
+// Generated by tools/gen_device_spec.py - do not edit
+//-----------------------------------------------------------------------------
+
+#include "device_spec.h"
+
+// Each starts with the descriptor length in bytes and type, then UTF-16 text
+{strings}
+
+const uint16_t *const device_spec_strings[DEVICE_SPEC_NUM_STRINGS] = {{
+{table}
+}};
+"""
+
+
+def fail(message):
+    sys.exit("device_spec.json: " + message)
+
+
+def parse_int(value):
+    return int(value, 0) if isinstance(value, str) else value
+
+
+def evaluate(expression, options):
+    if isinstance(expression, int):
+        return expression
+    return eval(expression, {"__builtins__": {}}, dict(options))
+
+
+# Short item with the smallest data size that holds the value, treating it as
+# signed for logical and physical extents as HID does
+def item(prefix, value, comment, signed=False):
+    for size, code in ((1, 1), (2, 2), (4, 3)):
+        low, high = (-(1 << (8 * size - 1)), (1 << (8 * size - 1)) - 1) if signed else (0, (1 << (8 * size)) - 1)
+        if low <= value <= high:
+            data = (value & ((1 << (8 * size)) - 1)).to_bytes(size, "little")
+            return (bytes([prefix | code]) + data, comment)
+    fail("value %d does not fit a HID item" % value)
+
+
+class Layout:
+    """Report layout for one combination of build options"""
+
+    def __init__(self, spec, options):
+        report = spec["report"]
+        self.options = options
+        self.axes = [axis for axis in report["axes"] if evaluate(axis.get("when", "True"), options)]
+        self.hats = [hat for hat in report.get("hats", []) if evaluate(hat.get("when", "True"), options)]
+        self.axis_bits = evaluate(report["axis_bits"], options)
+        self.buttons = evaluate(report["buttons"], options)
+        self.report_id = report["id"]
+
+        if self.axis_bits not in (8, 16):
+            fail("axis_bits must be 8 or 16, not %d" % self.axis_bits)
+        if not 0 <= self.buttons <= 32:
+            fail("between 0 and 32 buttons are supported")
+        for axis in self.axes:
+            if axis["usage"].upper() not in AXIS_USAGES:
+                fail("unknown axis usage %s" % axis["usage"])
+
+        self.bit_fields = self.buttons + HAT_BITS * len(self.hats)
+        self.padding = -self.bit_fields % 8
+        self.bit_bytes = (self.bit_fields + self.padding) // 8
+        self.descriptor = self.build_descriptor()
+
+    def axis_range(self):
+        if self.axis_bits == 16:
+            return -32767, 32767
+        return -128, 127
+
+    def build_descriptor(self):
+        items = [
+            item(USAGE_PAGE, USAGE_PAGE_DESKTOP, "Usage Page (Generic Desktop)"),
+            item(USAGE, USAGE_JOYSTICK, "Usage (Joystick)"),
+            item(COLLECTION, 0x01, "Collection (Application)"),
+            item(REPORT_ID, self.report_id, "Report ID (%d)" % self.report_id),
+        ]
+
+        if self.axes:
+            minimum, maximum = self.axis_range()
+            items.append(item(USAGE_PAGE, USAGE_PAGE_DESKTOP, "Usage Page (Generic Desktop)"))
+            for axis in self.axes:
+                items.append(item(USAGE, AXIS_USAGES[axis["usage"].upper()], "Usage (%s)" % axis["usage"].upper()))
+            items += [
+                item(LOGICAL_MIN, minimum, "Logical Minimum (%d)" % minimum, signed=True),
+                item(LOGICAL_MAX, maximum, "Logical Maximum (%d)" % maximum, signed=True),
+                item(REPORT_SIZE, self.axis_bits, "Report Size (%d)" % self.axis_bits),
+                item(REPORT_COUNT, len(self.axes), "Report Count (%d)" % len(self.axes)),
+                item(INPUT, DATA_VAR_ABS, "Input (Data, Variable, Absolute)"),
+            ]
+
+        if self.buttons:
+            items += [
+                item(USAGE_PAGE, USAGE_PAGE_BUTTON, "Usage Page (Button)"),
+                item(USAGE_MIN, 1, "Usage Minimum (1)"),
+                item(USAGE_MAX, self.buttons, "Usage Maximum (%d)" % self.buttons),
+                item(LOGICAL_MIN, 0, "Logical Minimum (0)", signed=True),
+                item(LOGICAL_MAX, 1, "Logical Maximum (1)", signed=True),
+                item(REPORT_COUNT, self.buttons, "Report Count (%d)" % self.buttons),
+                item(REPORT_SIZE, 1, "Report Size (1)"),
+                item(INPUT, DATA_VAR_ABS, "Input (Data, Variable, Absolute)"),
+            ]
+
+        if self.hats:
+            items += [
+                item(USAGE_PAGE, USAGE_PAGE_DESKTOP, "Usage Page (Generic Desktop)"),
+                item(LOGICAL_MIN, 0, "Logical Minimum (0)", signed=True),
+                item(LOGICAL_MAX, 7, "Logical Maximum (7)", signed=True),
+                item(PHYSICAL_MIN, 0, "Physical Minimum (0)", signed=True),
+                item(PHYSICAL_MAX, HAT_DEGREES, "Physical Maximum (%d)" % HAT_DEGREES, signed=True),
+                item(UNIT, UNIT_DEGREES, "Unit (Degrees)"),
+                item(REPORT_SIZE, HAT_BITS, "Report Size (%d)" % HAT_BITS),
+                item(REPORT_COUNT, 1, "Report Count (1)"),
+            ]
+            for _ in self.hats:
+                items += [
+                    item(USAGE, USAGE_HAT_SWITCH, "Usage (Hat Switch)"),
+                    item(INPUT, DATA_VAR_ABS_NULL, "Input (Data, Variable, Absolute, Null State)"),
+                ]
+            items.append(item(UNIT, 0, "Unit (None)"))
+
+        if self.padding:
+            items += [
+                item(REPORT_COUNT, 1, "Report Count (1)"),
+                item(REPORT_SIZE, self.padding, "Report Size (%d)" % self.padding),
+                item(INPUT, CONSTANT, "Input (Constant), padding to a whole byte"),
+            ]
+        return items
+
+    # Bits in the input report, found by walking the descriptor as a host
+    # would, rather than from the layout it was built from
+    def descriptor_report_bits(self):
+        report_size = report_count = bits = 0
+        for data, _ in self.descriptor:
+            prefix, value = data[0] & 0xFC, int.from_bytes(data[1:], "little")
+            if prefix == REPORT_SIZE:
+                report_size = value
+            elif prefix == REPORT_COUNT:
+                report_count = value
+            elif prefix == INPUT:
+                bits += report_size * report_count
+        return bits
+
+    def condition(self):
+        return " && ".join("%s == %d" % (name, value) for name, value in self.options)
+
+    def struct(self, name):
+        axis_type = "int16_t" if self.axis_bits == 16 else "int8_t"
+        lines = ["typedef struct __attribute__((packed)) {"]
+        for axis in self.axes:
+            lines.append("  %s %s;" % (axis_type, axis["name"]))
+        if self.bit_bytes:
+            parts = []
+            if self.buttons:
+                parts.append("buttons 1-%d" % self.buttons if self.buttons > 1 else "button 1")
+            if self.hats:
+                parts.append("%d hat%s" % (len(self.hats), "s" if len(self.hats) > 1 else ""))
+            if self.padding:
+                parts.append("padding")
+            lines.append("  uint8_t bits[%d];  // LSB first: %s" % (self.bit_bytes, ", then ".join(parts)))
+        lines.append("} %s;" % name)
+        return lines
+
+    # Each byte of the bit fields, as an expression over the button mask and
+    # hat positions
+    def bit_byte_expressions(self):
+        fields = []  # (expression, width, first bit in the report's bit fields)
+        if self.buttons:
+            fields.append(("buttons", self.buttons, 0))
+        for i, _ in enumerate(self.hats):
+            fields.append(("(uint32_t)(hats[%d] < 8 ? hats[%d] : 8)" % (i, i), HAT_BITS, self.buttons + HAT_BITS * i))
+
+        expressions = []
+        for byte in range(self.bit_bytes):
+            pieces = []
+            for expression, width, start in fields:
+                low, high = max(start, byte * 8), min(start + width, byte * 8 + 8)
+                if low >= high:
+                    continue
+                source_shift, dest_shift = low - start, low - byte * 8
+                mask = (1 << (high - low)) - 1
+                piece = "(%s >> %d)" % (expression, source_shift) if source_shift else expression
+                piece = "(%s & %#x)" % (piece, mask)
+                if dest_shift:
+                    piece = "(%s << %d)" % (piece, dest_shift)
+                pieces.append(piece)
+            expressions.append("(%s)" % " | ".join(pieces) if len(pieces) > 1 else pieces[0] if pieces else "0")
+        return expressions
+
+    def pack_function(self, name):
+        axis_type = "int16_t" if self.axis_bits == 16 else "int8_t"
+        lines = [
+            "static inline void %s_pack(%s *report, const int16_t *axes, uint32_t buttons, const uint8_t *hats) {" %
+            (name[:-2] if name.endswith("_t") else name, name),
+        ]
+        for i, axis in enumerate(self.axes):
+            value = "axes[%d]" % i if self.axis_bits == 16 else "axes[%d] >> 8" % i
+            lines.append("  report->%s = (%s)(%s);" % (axis["name"], axis_type, value))
+        for i, expression in enumerate(self.bit_byte_expressions()):
+            lines.append("  report->bits[%d] = (uint8_t)%s;" % (i, expression if expression.startswith("(") else
+                                                                  "(%s)" % expression))
+        if not self.hats:
+            lines.append("  (void)hats;")
+        lines.append("}")
+        return lines
+
+    def assertions(self, name):
+        report_bytes = self.descriptor_report_bits() // 8
+        lines = ['_Static_assert(sizeof(%s) == %d, "Report struct does not match the descriptor");' %
+                 (name, report_bytes)]
+        offset = 0
+        for axis in self.axes:
+            lines.append('_Static_assert(offsetof(%s, %s) == %d, "Report struct does not match the descriptor");' %
+                         (name, axis["name"], offset))
+            offset += self.axis_bits // 8
+        return lines
+
+    def descriptor_macro(self):
+        # Everything up to the end of the collection, which the caller closes
+        # after adding any reports of its own
+        lines = ["#define DEVICE_SPEC_HID_REPORT_DESC(...) \\"]
+        for data, comment in self.descriptor:
+            text = ", ".join("0x%02x" % byte for byte in data) + ","
+            lines.append("  %-28s /* %s */ \\" % (text, comment))
+        lines.append("  __VA_ARGS__ \\")
+        lines.append("  0x%02x  /* End Collection */" % END_COLLECTION)
+        return lines
+
+    def render(self, name):
+        lines = ["#if %s" % self.condition(), ""]
+        lines += ["#define DEVICE_SPEC_NUM_AXES %d" % len(self.axes),
+                  "#define DEVICE_SPEC_NUM_BUTTONS %d" % self.buttons,
+                  "#define DEVICE_SPEC_NUM_HATS %d" % len(self.hats),
+                  "#define DEVICE_SPEC_AXIS_BITS %d" % self.axis_bits,
+                  ""]
+        lines += ["// HID report descriptor for the input report. Feature reports and the",
+                  "// like go in the arguments, inside the application collection."]
+        lines += self.descriptor_macro() + [""]
+        lines += self.struct(name) + [""]
+        lines += self.assertions(name) + [""]
+        lines += ["// Pack calibrated axes (-32767 to 32767, in descriptor order), a button mask",
+                  "// (bit 0 for button 1) and hat positions (0-7 clockwise from up, anything",
+                  "// else for centred) into a report. hats may be NULL when there are none."]
+        lines += self.pack_function(name) + [""]
+        return lines
+
+
+def string_descriptor(text):
+    encoded = text.encode("utf-16-le")
+    length = 2 + len(encoded)
+    if length > 255:
+        fail("string %r is too long for a descriptor" % text)
+    words = [int.from_bytes(encoded[i:i + 2], "little") for i in range(0, len(encoded), 2)]
+    return [(0x03 << 8) | length] + words
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--spec", required=True)
+    parser.add_argument("--output-dir", required=True)
+    args = parser.parse_args()
+
+    with open(args.spec) as f:
+        spec = json.load(f)
+
+    name = spec["report"]["name"]
+    option_names = list(spec["options"])
+    layouts = [Layout(spec, list(zip(option_names, values)))
+               for values in itertools.product(*(spec["options"][option] for option in option_names))]
+
+    variants = []
+    for i, layout in enumerate(layouts):
+        lines = layout.render(name)
+        lines[0] = ("#if " if i == 0 else "#elif ") + layout.condition()
+        variants += lines
+    variants += ["#else", '#error "No layout in device_spec.json for these build options"', "#endif"]
+
+    strings = spec["strings"]
+    string_names = [key for key in strings if key != "language"]
+    descriptors = [[(0x03 << 8) | 4, parse_int(strings["language"])]]
+    descriptors += [string_descriptor(strings[key]) for key in string_names]
+
+    string_indices = "\n".join("#define DEVICE_SPEC_STRING_%s %d" % (key.upper(), i + 1)
+                               for i, key in enumerate(string_names))
+    device = spec["device"]
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    with open(os.path.join(args.output_dir, "device_spec.h"), "w") as f:
+        f.write(HEADER_TEMPLATE.format(vid=parse_int(device["vid"]), pid=parse_int(device["pid"]),
+                                       release=parse_int(device["release"]), report_id=spec["report"]["id"],
+                                       string_indices=string_indices, num_strings=len(descriptors)))
+    with open(os.path.join(args.output_dir, "device_spec_report.h"), "w") as f:
+        f.write(REPORT_HEADER_TEMPLATE.format(options=", ".join(option_names), variants="\n".join(variants)))
+
+    string_lines = []
+    for i, words in enumerate(descriptors):
+        label = "language" if i == 0 else repr(strings[string_names[i - 1]])
+        string_lines.append("static const uint16_t string_%d[] = {%s};  // %s" %
+                            (i, ", ".join("%#06x" % word for word in words), label))
+    table = "\n".join("  string_%d," % i for i in range(len(descriptors)))
+    with open(os.path.join(args.output_dir, "device_spec.c"), "w") as f:
+        f.write(SOURCE_TEMPLATE.format(strings="\n".join(string_lines), table=table))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,46 @@
+#-----------------------------------------------------------------------------
+# Feature report access to the joystick adapter through the Linux hidraw
+# interface, shared by the tools that talk to it
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+import fcntl
+import glob
+import os
+import sys
+
+from device_spec import USB_PID, USB_VID
+
+
+def hidioc(nr, length):
+    # _IOC(_IOC_READ | _IOC_WRITE, 'H', nr, length)
+    return (3 << 30) | (length << 16) | (ord("H") << 8) | nr
+
+
+def find_device():
+    for uevent in sorted(glob.glob("/sys/class/hidraw/hidraw*/device/uevent")):
+        with open(uevent) as f:
+            if "HID_ID=0003:%08X:%08X" % (USB_VID, USB_PID) in f.read().upper():
+                return "/dev/" + uevent.split("/")[4]
+    sys.exit("no joystick adapter found, use --device")
+
+
+def open_device(path=None):
+    try:
+        return os.open(path or find_device(), os.O_RDWR)
+    except OSError as error:
+        sys.exit(error)
+
+
+def set_feature(fd, report_id, payload):
+    data = bytearray([report_id]) + payload
+    fcntl.ioctl(fd, hidioc(0x06, len(data)), data)
+
+
+# Returns the report without its ID, which may be shorter than asked for
+def get_feature(fd, report_id, max_length):
+    data = bytearray(1 + max_length)
+    data[0] = report_id
+    received = fcntl.ioctl(fd, hidioc(0x07, len(data)), data, True)
+    return bytes(data[1:received])
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# Reads and changes the joystick adapter's settings while it runs, and shows
+# its live stats, through the Linux hidraw interface
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+import hidraw
+
+REPORT_ID_CONFIG = 3  # USB_HID_REPORT_ID_CONFIG
+REPORT_ID_STATS = 4   # USB_HID_REPORT_ID_STATS
+CONFIG = struct.Struct("<HHHH")  # hid_config_report_t
+STATS = struct.Struct("<IIIHHIIII")  # hid_stats_report_t, followed by the axes
+CONFIG_FIELDS = ["report_interval_ms", "filter_window", "adc_clock_div", "deadzone_permille"]
+MAX_AXES = 4
+
+
+def read_config(fd):
+    data = hidraw.get_feature(fd, REPORT_ID_CONFIG, CONFIG.size)
+    if len(data) < CONFIG.size:
+        sys.exit("config report too short, is the firmware up to date?")
+    return dict(zip(CONFIG_FIELDS, CONFIG.unpack(data)))
+
+
+def print_config(config):
+    filter_window = config["filter_window"] or "built-in"
+    print("report interval %d ms, filter window %s, ADC clock divider %d, deadzone %d permille" %
+          (config["report_interval_ms"], filter_window, config["adc_clock_div"], config["deadzone_permille"]))
+
+
+def print_stats(fd):
+    data = hidraw.get_feature(fd, REPORT_ID_STATS, STATS.size + MAX_AXES * 2)
+    if len(data) < STATS.size:
+        sys.exit("stats report too short, is the firmware up to date?")
+    (uptime_ms, reports, edges_dropped, busy_permille, wakeups, latency_count, latency_mean_us,
+     latency_max_us, first_report_us) = STATS.unpack_from(data)
+    axes = struct.unpack_from("<%dH" % ((len(data) - STATS.size) // 2), data, STATS.size)
+
+    print("up %.1f s, %d reports, %d edges dropped, core 0 %.1f%% busy, %d wake-ups/s" %
+          (uptime_ms / 1e3, reports, edges_dropped, busy_permille / 10, wakeups))
+    if latency_count:
+        print("sample to host: n %d, mean %d us, max %d us" % (latency_count, latency_mean_us, latency_max_us))
+    if first_report_us:
+        print("first report %.1f ms after reset" % (first_report_us / 1e3))
+    print("axes: " + " ".join("%5d" % axis for axis in axes))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--device", help="hidraw device, found by USB ID if not given")
+    parser.add_argument("--report-interval", type=int, metavar="MS", help="time between reports")
+    parser.add_argument("--filter-window", type=int, metavar="SAMPLES",
+                        help="moving average length, 0 for the built-in filter chain")
+    parser.add_argument("--adc-clock-div", type=int, metavar="DIV", help="ADC clock divider, see joystick.h")
+    parser.add_argument("--deadzone", type=int, metavar="PERMILLE", help="deadzone of every axis")
+    parser.add_argument("--watch", type=float, metavar="SECONDS", help="keep showing the stats this often")
+    args = parser.parse_args()
+
+    changes = {"report_interval_ms": args.report_interval, "filter_window": args.filter_window,
+               "adc_clock_div": args.adc_clock_div, "deadzone_permille": args.deadzone}
+    changes = {field: value for field, value in changes.items() if value is not None}
+
+    fd = hidraw.open_device(args.device)
+    try:
+        config = read_config(fd)
+        if changes:
+            config.update(changes)
+            hidraw.set_feature(fd, REPORT_ID_CONFIG, CONFIG.pack(*(config[field] for field in CONFIG_FIELDS)))
+
+            # The device ignores the whole report if any setting is out of range
+            applied = read_config(fd)
+            if any(applied[field] != value for field, value in changes.items()):
+                print("settings rejected, out of range")
+            config = applied
+        print_config(config)
+
+        print_stats(fd)
+        while args.watch:
+            time.sleep(args.watch)
+            print_stats(fd)
+    except OSError as error:
+        sys.exit("feature report failed: %s" % error)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.close(fd)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# Reads the on-target profiler over USB, from firmware built with
+# JOYSTICK_PROFILE, through the Linux hidraw interface
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+import argparse
+import os
+import struct
+import sys
+
+import hidraw
+
+REPORT_ID_PROFILE = 2  # USB_HID_REPORT_ID_PROFILE
+PROFILE_RESET = 0xFF   # USB_HID_PROFILE_RESET
+REPORT = struct.Struct("<BBIIIIQ16s")  # hid_profile_report_t
+
+
+def set_feature(fd, probe):
+    hidraw.set_feature(fd, REPORT_ID_PROFILE, bytearray([probe]) + bytearray(REPORT.size - 1))
+
+
+def get_feature(fd):
+    data = hidraw.get_feature(fd, REPORT_ID_PROFILE, REPORT.size)
+    if len(data) < REPORT.size:
+        sys.exit("profile report too short, is the firmware built with JOYSTICK_PROFILE?")
+    return REPORT.unpack(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--device", help="hidraw device, found by USB ID if not given")
+    parser.add_argument("--reset", action="store_true", help="clear the stats after reading them")
+    args = parser.parse_args()
+
+    fd = hidraw.open_device(args.device)
+
+    try:
+        set_feature(fd, 0)
+        first = get_feature(fd)
+        num_probes, counter_hz = first[1], first[2]
+        rows = [first] + [get_feature(fd) for _ in range(num_probes - 1)]
+        if args.reset:
+            set_feature(fd, PROFILE_RESET)
+    except OSError as error:
+        sys.exit("feature report failed: %s" % error)
+    finally:
+        os.close(fd)
+
+    cycles_per_us = counter_hz / 1e6
+    print("%-16s %10s %10s %10s %10s %10s" % ("probe", "count", "min", "mean", "max", "max (us)"))
+    for probe, _, _, count, min_cycles, max_cycles, total_cycles, name in rows:
+        name = name.split(b"\0")[0].decode()
+        if not count:
+            print("%-16s %10d" % (name, 0))
+            continue
+        print("%-16s %10d %10d %10.1f %10d %10.2f" % (name, count, min_cycles, total_cycles / count, max_cycles,
+                                                      max_cycles / cycles_per_us))
+
+
+if __name__ == "__main__":
+    main()
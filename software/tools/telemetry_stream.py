@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+#-----------------------------------------------------------------------------
+# Records the raw input stream from firmware built with JOYSTICK_TELEMETRY
+# into a capture file, for host/replay.c. Needs pyusb.
+#
+# Copyright 2023 Alan Reed (areed.me)
+#-----------------------------------------------------------------------------
+
+import argparse
+import struct
+import sys
+import time
+
+import usb.core
+import usb.util
+
+from device_spec import USB_PID, USB_VID
+
+# telemetry.h
+REQUEST_START = 1
+REQUEST_STOP = 2
+REQUEST_INFO = 3
+BLOCK_BYTES = 64 * 8  # TELEMETRY_BLOCK_RECORDS capture records
+
+HEADER = struct.Struct("<IHHIIII4H20H")   # capture_header_t
+INFO = struct.Struct("<IHHIIII4H20HBBI")  # telemetry_info_t
+RECORD = struct.Struct("<IHBB")           # capture_record_t
+TYPE_BUTTON = 1
+
+
+def find_interface(device):
+    for interface in device.get_active_configuration():
+        if interface.bInterfaceClass == usb.CLASS_VENDOR_SPEC:
+            return interface
+    sys.exit("no telemetry interface, is the firmware built with JOYSTICK_TELEMETRY?")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("output", help="capture file to write")
+    parser.add_argument("--seconds", type=float, help="stop after this long, rather than on Ctrl-C")
+    args = parser.parse_args()
+
+    device = usb.core.find(idVendor=USB_VID, idProduct=USB_PID)
+    if device is None:
+        sys.exit("no joystick adapter found")
+
+    interface = find_interface(device)
+    endpoint = interface[0]
+    out_request = usb.util.build_request_type(usb.util.CTRL_OUT, usb.util.CTRL_TYPE_VENDOR,
+                                              usb.util.CTRL_RECIPIENT_INTERFACE)
+    in_request = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR,
+                                             usb.util.CTRL_RECIPIENT_INTERFACE)
+    usb.util.claim_interface(device, interface.bInterfaceNumber)
+
+    device.ctrl_transfer(out_request, REQUEST_START, 0, interface.bInterfaceNumber)
+    info = device.ctrl_transfer(in_request, REQUEST_INFO, 0, interface.bInterfaceNumber, INFO.size)
+    fields = INFO.unpack(bytes(info))
+    header, (buttons, num_buttons, _) = list(fields[:-3]), fields[-3:]
+    flags, start_us = header[3], header[5]
+
+    records = []
+    deadline = time.monotonic() + args.seconds if args.seconds else None
+    print("streaming, flags %#x" % flags)
+    try:
+        while deadline is None or time.monotonic() < deadline:
+            try:
+                data = bytes(endpoint.read(BLOCK_BYTES, timeout=1000))
+            except usb.core.USBTimeoutError:
+                continue
+            for offset in range(0, len(data) - RECORD.size + 1, RECORD.size):
+                record = RECORD.unpack_from(data, offset)
+                # A block finished just as streaming started may predate it
+                if (record[0] - start_us) & 0x80000000 == 0:
+                    records.append(record)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        device.ctrl_transfer(out_request, REQUEST_STOP, 0, interface.bInterfaceNumber)
+        info = device.ctrl_transfer(in_request, REQUEST_INFO, 0, interface.bInterfaceNumber, INFO.size)
+        dropped = INFO.unpack(bytes(info))[-1]
+        usb.util.release_interface(device, interface.bInterfaceNumber)
+
+    if not records:
+        sys.exit("nothing received")
+
+    # Starting button levels, as edges at the time of the first record, as
+    # capture_dump() writes them
+    first_us = records[0][0]
+    starting = [(first_us, (buttons >> button) & 1, TYPE_BUTTON, button) for button in range(num_buttons)]
+    records = starting + records
+
+    with open(args.output, "wb") as output:
+        # The settings are as they were when streaming started
+        header[4:6] = len(records), records[-1][0]
+        output.write(HEADER.pack(*header))
+        for record in records:
+            output.write(RECORD.pack(*record))
+
+    span_us = (records[-1][0] - first_us) & 0xFFFFFFFF
+    print("%d records over %.3f s, %d dropped" % (len(records), span_us / 1e6, dropped))
+
+
+if __name__ == "__main__":
+    main()
@@ -8,15 +8,9 @@
 #define __USB_DESCRIPTORS_H__
 
 #include "tusb.h"
+#include "telemetry.h"
 #include "usb_hid.h"
 
-//-----------------------------------------------------------------------------
-// Device descriptor constants
-//-----------------------------------------------------------------------------
-
-#define USB_VID   0x7EED
-#define USB_PID   0x0001
-
 //-----------------------------------------------------------------------------
 // Device descriptor
 //-----------------------------------------------------------------------------
@@ -31,13 +25,13 @@ tusb_desc_device_t const desc_device =
     .bDeviceProtocol    = 0x00,   // No boot interface protocol
     .bMaxPacketSize0    = CFG_TUD_ENDPOINT0_SIZE,
 
-    .idVendor           = USB_VID,
-    .idProduct          = USB_PID,
-    .bcdDevice          = 0x0100, // Device release number 1.0
+    .idVendor           = DEVICE_SPEC_VID,  // From device_spec.json
+    .idProduct          = DEVICE_SPEC_PID,
+    .bcdDevice          = DEVICE_SPEC_RELEASE,
 
-    .iManufacturer      = 0x01,   // String descriptor indices
-    .iProduct           = 0x02,
-    .iSerialNumber      = 0x03,
+    .iManufacturer      = DEVICE_SPEC_STRING_MANUFACTURER,  // String descriptor indices
+    .iProduct           = DEVICE_SPEC_STRING_PRODUCT,
+    .iSerialNumber      = DEVICE_SPEC_STRING_SERIAL,
 
     .bNumConfigurations = 0x01    // Only 1 configuration descriptor
 };
@@ -47,40 +41,36 @@ tusb_desc_device_t const desc_device =
 // HID report descriptor
 //-----------------------------------------------------------------------------
 
-// Custom HID report descriptor, for a joystick with 2 axes and 2 buttons,
-// based upon the example templates in TinyUSB's hid_device.h.
-// Should match report struct definition in usb_hid.h
-#define TUD_HID_REPORT_DESC_JOYSTICK(...)                                                 \
-    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                               \
-        HID_USAGE(HID_USAGE_DESKTOP_JOYSTICK),                                            \
-        HID_COLLECTION(HID_COLLECTION_APPLICATION), /* Report ID if any */                \
-        __VA_ARGS__                                                                       \
-        /* 8 bits each for X and Y axes, minimum value -128 (0x80), maximum 127 (0x7f) */ \
-        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                           \
-        HID_USAGE(HID_USAGE_DESKTOP_X),                                                   \
-        HID_USAGE(HID_USAGE_DESKTOP_Y),                                                   \
-        HID_LOGICAL_MIN(0x80),                                                            \
-        HID_LOGICAL_MAX(0x7f),                                                            \
-        HID_REPORT_COUNT(2),                                                              \
+// Vendor-defined feature report, an opaque block of bytes laid out as the
+// given struct in usb_hid.h
+#define HID_REPORT_DESC_VENDOR_FEATURE(_report_id, _usage, _type)                        \
+        HID_REPORT_ID(_report_id)                                                         \
+        HID_USAGE_PAGE_N(HID_USAGE_PAGE_VENDOR, 2),                                       \
+        HID_USAGE(_usage),                                                                \
+        HID_LOGICAL_MIN(0x00),                                                            \
+        HID_LOGICAL_MAX_N(0xff, 2),                                                       \
         HID_REPORT_SIZE(8),                                                               \
-        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),                                \
-        /* 2 bit button map */                                                            \
-        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),                                            \
-        HID_USAGE_MIN(1),                                                                 \
-        HID_USAGE_MAX(2),                                                                 \
-        HID_LOGICAL_MIN(0),                                                               \
-        HID_LOGICAL_MAX(1),                                                               \
-        HID_REPORT_COUNT(2),                                                              \
-        HID_REPORT_SIZE(1),                                                               \
-        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),                                \
-        /* 6 bit padding to bring up to a whole byte */                                   \
-        HID_REPORT_COUNT(1),                                                              \
-        HID_REPORT_SIZE(6),                                                               \
-        HID_INPUT(HID_CONSTANT),                                                          \
-        HID_COLLECTION_END
-
+        HID_REPORT_COUNT(sizeof(_type)),                                                  \
+        HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+
+// Runtime settings and live stats, see hid_config_report_t and hid_stats_report_t
+#define HID_REPORT_DESC_CONFIG_FEATURES                                                   \
+        HID_REPORT_DESC_VENDOR_FEATURE(USB_HID_REPORT_ID_CONFIG, 0x02, hid_config_report_t) \
+        HID_REPORT_DESC_VENDOR_FEATURE(USB_HID_REPORT_ID_STATS, 0x03, hid_stats_report_t)
+
+#if JOYSTICK_PROFILE
+// Profiler read-out, see hid_profile_report_t
+#define HID_REPORT_DESC_PROFILE_FEATURE                                                   \
+        HID_REPORT_DESC_VENDOR_FEATURE(USB_HID_REPORT_ID_PROFILE, 0x01, hid_profile_report_t)
+#else
+#define HID_REPORT_DESC_PROFILE_FEATURE
+#endif
+
+// Joystick input report generated from device_spec.json, with the feature
+// reports inside the same application collection
 uint8_t const desc_hid_report[] = {
-  TUD_HID_REPORT_DESC_JOYSTICK()
+  DEVICE_SPEC_HID_REPORT_DESC(HID_REPORT_DESC_CONFIG_FEATURES
+                              HID_REPORT_DESC_PROFILE_FEATURE)
 };
 
 
@@ -88,7 +78,11 @@ uint8_t const desc_hid_report[] = {
 // Configuration descriptor constants
 //-----------------------------------------------------------------------------
 
+#if JOYSTICK_TELEMETRY
+#define CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN + TELEMETRY_DESC_LEN)
+#else
 #define CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN)
+#endif
 #define POWER_CONSUMPTION_MA 100
 
 // Bit 0..3 The endpoint number
@@ -97,12 +91,17 @@ uint8_t const desc_hid_report[] = {
 // 0 - OUT endpoint
 // 1 - IN endpoint
 #define ENDPOINT_IN_ADDRESS  01 | 1 << 7   // Endpoint 1, direction IN
+#define TELEMETRY_ENDPOINT_IN_ADDRESS  02 | 1 << 7  // Endpoint 2, direction IN
+#define TELEMETRY_ENDPOINT_SIZE 64                  // Largest full-speed bulk packet
 #define STRING_DESCRIPTOR_INDEX 0
 
 // Interface descriptor numbers
 enum
 {
   INTERFACE_NUM_HID,
+#if JOYSTICK_TELEMETRY
+  INTERFACE_NUM_TELEMETRY,
+#endif
   INTERFACE_NUM_TOTAL
 };
 
@@ -126,18 +125,16 @@ uint8_t const desc_configuration[] = {
                      ENDPOINT_IN_ADDRESS,       // Endpoint In address
                      CFG_TUD_HID_EP_BUFSIZE,    // Size of HID endpoint
                      USB_HID_POLL_INTERVAL_MS)  // Polling interval
+#if JOYSTICK_TELEMETRY
+  ,
+  // Raw input stream, see telemetry.h
+  TUD_TELEMETRY_DESCRIPTOR(INTERFACE_NUM_TELEMETRY,        // Interface number
+                           STRING_DESCRIPTOR_INDEX,        // String descriptor index
+                           TELEMETRY_ENDPOINT_IN_ADDRESS,  // Endpoint In address
+                           TELEMETRY_ENDPOINT_SIZE)        // Size of bulk endpoint
+#endif
 };
 
-//-----------------------------------------------------------------------------
-// String descriptor
-//-----------------------------------------------------------------------------
-
-char const* string_descriptors [] =
-{
-  (const char[]) { 0x09, 0x08 }, // 0: Supported language is UK English (0x0809)
-  "AReed",                       // 1: Manufacturer name
-  "PicoJoystick",                // 2: Product name
-  "00001",                       // 3: Serial number
-};
+// String descriptors are pre-encoded from device_spec.json, see device_spec_strings
 
 #endif // __USB_DESCRIPTORS_H__
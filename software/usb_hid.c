@@ -6,47 +6,439 @@
 
 #include "usb_hid.h"
 
-#include <math.h>
+#include <string.h>
 
+#include "calibration.h"
+#include "capture.h"
 #include "joystick.h"
+#include "latency.h"
 #include "pico/time.h"
+#include "profile.h"
+#include "scheduler.h"
 #include "tusb.h"
 
+//-----------------------------------------------------------------------------
+// Private constants
+//-----------------------------------------------------------------------------
+#if USB_HID_16BIT_AXES && !JOYSTICK_ADC_DMA
+#warning "16-bit HID axes without JOYSTICK_ADC_DMA will mostly be reporting ADC noise"
+#endif
+
+// Hysteresis in calibrated axis units, before the report drops any low bits
+#define AXIS_HYSTERESIS ((int32_t)USB_HID_AXIS_HYSTERESIS << (16 - DEVICE_SPEC_AXIS_BITS))
+
 //-----------------------------------------------------------------------------
 // Private variables
 //-----------------------------------------------------------------------------
-static joystick_state_t joystick = {0, 0, 0, 0};
+static joystick_state_t joystick = {0};
+
+// Buttons are reported from debounced edges, one report per edge at least
+static uint8_t buttons = 0;
+static button_edge_t edge;
+static bool edge_pending = false;
+
+// Timestamps of the report waiting to be collected by the host
+static struct {
+  bool pending;
+  bool has_edge;
+  uint32_t report_us;
+  uint32_t sample_us;
+  uint32_t edge_us;
+} in_flight;
+
+// Settings from the config feature report
+static uint16_t report_interval_ms = USB_HID_POLL_INTERVAL_MS;
+static uint16_t filter_window = 0;  // 0 for the built-in filter chain
+static filter_config_t filter_configs[2];
+static uint8_t filter_config_index = 0;
 
+static uint32_t reports_sent = 0;
+static uint32_t first_report_us = 0;  // Time since reset, or 0 until the first report is sent
+
+// Idle duration from SET_IDLE, after which an unchanged report is sent again.
+// 0 only sends on change.
+static uint32_t idle_ms = USB_HID_HEARTBEAT_MS;
+
+// Axis values that have moved past the hysteresis, which the reports carry
+static int16_t held_axes[JOYSTICK_NUM_AXES];
+
+// The report the host was last sent, to tell whether anything has changed
+static hid_joystick_report_t last_report;
+static uint32_t last_report_time_us;
+static bool report_sent = false;
+
+#if !USB_HID_FAST_POLL
 static struct repeating_timer hid_report_timer;
-static bool send_hid_report = false;
+static volatile bool send_hid_report = false;
+#endif
+
+#if JOYSTICK_PROFILE
+static uint8_t profile_probe = 0;  // Probe the next profile feature report returns
+#endif
 
 //-----------------------------------------------------------------------------
 // Private functions
 //-----------------------------------------------------------------------------
+// Fetch the next button edge, unless one is already waiting to be reported
+static bool next_edge(void) {
+  if (!edge_pending) {
+    edge_pending = joystick_next_edge(&edge);
+  }
+  return edge_pending;
+}
+
+// Returns the button mask the report carries
+static uint8_t build_report(hid_joystick_report_t *report) {
+  joystick_read(&joystick);
+  calibration_update(&joystick);
+
+  int16_t axes[JOYSTICK_NUM_AXES] = {
+      calibration_apply(CALIBRATION_AXIS_X, joystick.x_axis),
+      calibration_apply(CALIBRATION_AXIS_Y, joystick.y_axis),
+#if JOYSTICK_NUM_AXES > 2
+      calibration_apply(CALIBRATION_AXIS_X2, joystick.x2_axis),
+      calibration_apply(CALIBRATION_AXIS_Y2, joystick.y2_axis),
+#endif
+  };
+  for (uint8_t axis = 0; axis < JOYSTICK_NUM_AXES; axis++) {
+    // Centred while unplugged, whatever the calibration makes of the raw value
+    if (!(joystick.axes_connected & 1u << axis)) {
+      axes[axis] = 0;
+    }
+
+    int32_t moved = axes[axis] - held_axes[axis];
+    if (!report_sent || moved > AXIS_HYSTERESIS || moved < -AXIS_HYSTERESIS) {
+      held_axes[axis] = axes[axis];
+    }
+  }
+
+  uint8_t report_buttons = buttons;
+  if (edge_pending) {
+    report_buttons = edge.pressed ? buttons | 1 << edge.button : buttons & ~(1 << edge.button);
+  }
+
+  hid_joystick_report_pack(report, held_axes, report_buttons, NULL);
+  return report_buttons;
+}
+
+// Send a report built from the joystick state last read, and record how long
+// its inputs took to get this far
+static bool send_report(const hid_joystick_report_t *report, uint8_t report_buttons) {
+  if (!tud_hid_report(USB_HID_REPORT_ID_JOYSTICK, report, sizeof(*report))) {
+    return false;
+  }
+
+  uint32_t now_us = time_us_32();
+  last_report = *report;
+  last_report_time_us = now_us;
+  report_sent = true;
+  if (!reports_sent++) {
+    first_report_us = now_us ? now_us : 1;
+  }
+  latency_record(LATENCY_SAMPLE_TO_READ, joystick.timestamp_us - joystick.sample_timestamp_us);
+  latency_record(LATENCY_READ_TO_REPORT, now_us - joystick.timestamp_us);
+
+  in_flight.pending = true;
+  in_flight.report_us = now_us;
+  in_flight.sample_us = joystick.sample_timestamp_us;
+  in_flight.edge_us = edge.timestamp_us;
+  in_flight.has_edge = edge_pending;
+
+  buttons = report_buttons;
+  if (edge_pending) {
+    edge_pending = false;
+    latency_record(LATENCY_EDGE_TO_REPORT, now_us - edge.timestamp_us);
+  }
+
+  return true;
+}
+
+static bool report_changed(const hid_joystick_report_t *report) {
+  return !report_sent || memcmp(report, &last_report, sizeof(*report));
+}
+
+// Whether the host is due an unchanged report
+static bool idle_expired(uint32_t now_us) {
+  return idle_ms && (now_us - last_report_time_us) >= idle_ms * 1000u;
+}
+
+#if USB_HID_FAST_POLL
+
+static bool report_interval_elapsed(uint32_t now_us) {
+  // At the poll interval the host already paces the reports
+  return report_interval_ms <= USB_HID_POLL_INTERVAL_MS || (now_us - last_report_time_us) >= report_interval_ms * 1000u;
+}
+
+static void set_report_interval(uint16_t interval_ms) {
+  report_interval_ms = interval_ms;
+}
+#else
 static bool hid_report_timer_callback(struct repeating_timer *t) {
   send_hid_report = true;
+  scheduler_post(SCHEDULER_EVENT_REPORT);
+  return true;
+}
+
+static void set_report_interval(uint16_t interval_ms) {
+  if (interval_ms != report_interval_ms) {
+    report_interval_ms = interval_ms;
+    cancel_repeating_timer(&hid_report_timer);
+    add_repeating_timer_ms(report_interval_ms, &hid_report_timer_callback, NULL, &hid_report_timer);
+  }
+}
+#endif
+
+static void set_filter_window(uint16_t window) {
+  filter_window = window;
+  if (!window) {
+    joystick_set_filter(NULL);
+    return;
+  }
+
+  // Alternate between two configs, so one the acquisition interrupt has not
+  // taken yet is never changed under it
+  filter_config_index ^= 1;
+  filter_config_t *config = &filter_configs[filter_config_index];
+  config->num_stages = 1;
+  config->stages[0] = (filter_stage_config_t)FILTER_STAGE_BOXCAR(window);
+  joystick_set_filter(config);
+}
+
+static void set_deadzone(uint16_t deadzone_permille) {
+  calibration_axis_t settings;
+
+  for (uint8_t axis = 0; axis < CALIBRATION_NUM_AXES; axis++) {
+    calibration_get(axis, &settings);
+    if (settings.deadzone_permille != deadzone_permille) {
+      settings.deadzone_permille = deadzone_permille;
+      calibration_set(axis, &settings);
+    }
+  }
+}
+
+static uint16_t get_config_report(hid_config_report_t *report) {
+  calibration_axis_t settings;
+  calibration_get(CALIBRATION_AXIS_X, &settings);
+
+  report->report_interval_ms = report_interval_ms;
+  report->filter_window = filter_window;
+  report->adc_clock_div = joystick_adc_clock_div();
+  report->deadzone_permille = settings.deadzone_permille;
+  return sizeof(*report);
+}
+
+// Runs from tud_task(), in between calls to usb_task(), so no report is
+// built with only some of the settings changed
+static void set_config_report(const hid_config_report_t *report) {
+  if (report->report_interval_ms < USB_HID_POLL_INTERVAL_MS ||
+      report->report_interval_ms > USB_HID_MAX_REPORT_INTERVAL_MS ||
+      report->filter_window > BUFFER_MAX_WINDOW || report->deadzone_permille > 999) {
+    return;
+  }
+#if JOYSTICK_ADC_MIN_CLOCK_DIV > 0
+  if (report->adc_clock_div < JOYSTICK_ADC_MIN_CLOCK_DIV) {
+    return;
+  }
+#endif
+
+  set_report_interval(report->report_interval_ms);
+  if (report->filter_window != filter_window) {
+    set_filter_window(report->filter_window);
+  }
+  joystick_set_adc_clock_div(report->adc_clock_div);
+  set_deadzone(report->deadzone_permille);
+
+  // A replay could not know when the host made the change
+  capture_reset();
+}
+
+static uint16_t get_stats_report(hid_stats_report_t *report) {
+  scheduler_stats_t scheduler_stats;
+  latency_histogram_t histogram;
+  joystick_state_t state;
+
+  scheduler_read_stats(&scheduler_stats);
+  latency_read(LATENCY_SAMPLE_TO_COMPLETE, &histogram);
+  joystick_read(&state);
+
+  memset(report, 0, sizeof(*report));
+  report->uptime_ms = (uint32_t)(time_us_64() / 1000);
+  report->reports_sent = reports_sent;
+  report->edges_dropped = joystick_edges_dropped();
+  report->busy_permille = scheduler_stats.busy_permille;
+  report->wakeups_per_second =
+      (uint16_t)(scheduler_stats.wakeups_per_window * 1000000ull / SCHEDULER_STATS_WINDOW_US);
+  report->first_report_us = first_report_us;
+  report->latency_count = histogram.count;
+  if (histogram.count) {
+    report->latency_mean_us = (uint32_t)(histogram.total_us / histogram.count);
+    report->latency_max_us = histogram.max_us;
+  }
+  report->axes[0] = state.x_axis;
+  report->axes[1] = state.y_axis;
+#if JOYSTICK_NUM_AXES > 2
+  report->axes[2] = state.x2_axis;
+  report->axes[3] = state.y2_axis;
+#endif
+  return sizeof(*report);
 }
 
 //-----------------------------------------------------------------------------
 // Public functions
 //-----------------------------------------------------------------------------
+#if USB_HID_FAST_POLL
 void usb_init(void) {
-  add_repeating_timer_ms(USB_HID_POLL_INTERVAL_MS, &hid_report_timer_callback, NULL, &hid_report_timer);
+  calibration_init();
+  capture_reset();
 }
 
 void usb_task(void) {
-  if (send_hid_report) {
+  PROFILE_SCOPE(PROFILE_USB_TASK);
+
+  // The endpoint can only hold one report, so there is nothing to decide
+  // until the host has collected the previous one
+  if (!tud_hid_ready()) {
+    return;
+  }
+
+  bool has_edge = next_edge();
+  hid_joystick_report_t report;
+  uint8_t report_buttons = build_report(&report);
+
+  // Every debounced edge gets a report of its own
+  uint32_t now_us = time_us_32();
+  bool changed = report_changed(&report);
+  if (has_edge || (changed && (!report_sent || report_interval_elapsed(now_us))) || idle_expired(now_us)) {
+    send_report(&report, report_buttons);
+  }
+}
+#else
+void usb_init(void) {
+  calibration_init();
+  add_repeating_timer_ms(report_interval_ms, &hid_report_timer_callback, NULL, &hid_report_timer);
+  capture_reset();
+}
+
+void usb_task(void) {
+  PROFILE_SCOPE(PROFILE_USB_TASK);
+
+  // Button edges are sent as soon as the endpoint is free, rather than
+  // waiting for the next tick
+  if (tud_hid_ready() && (next_edge() || send_hid_report)) {
     send_hid_report = false;
 
-    joystick_read(&joystick);
+    hid_joystick_report_t report;
+    uint8_t report_buttons = build_report(&report);
 
-    if (tud_hid_ready()) {
-      hid_joystick_report_t report = {
-          joystick_rescale_axis(joystick.x_axis),
-          joystick_rescale_axis(joystick.y_axis),
-          joystick.button_1 | joystick.button_2 << 1};
+    // The host already has an unchanged report, until the idle rate says otherwise
+    if (edge_pending || report_changed(&report) || idle_expired(time_us_32())) {
+      send_report(&report, report_buttons);
+    }
+  }
+}
+#endif
 
-      tud_hid_report(0, &report, sizeof(report));
+uint32_t usb_hid_first_report_us(void) {
+  return first_report_us;
+}
+
+uint16_t usb_hid_get_feature(uint8_t report_id, uint8_t *buffer, uint16_t reqlen) {
+  if (report_id == USB_HID_REPORT_ID_CONFIG && reqlen >= sizeof(hid_config_report_t)) {
+    hid_config_report_t report;
+    uint16_t len = get_config_report(&report);
+    memcpy(buffer, &report, len);
+    return len;
+  }
+  if (report_id == USB_HID_REPORT_ID_STATS && reqlen >= sizeof(hid_stats_report_t)) {
+    hid_stats_report_t report;
+    uint16_t len = get_stats_report(&report);
+    memcpy(buffer, &report, len);
+    return len;
+  }
+#if JOYSTICK_PROFILE
+  if (report_id == USB_HID_REPORT_ID_PROFILE && reqlen >= sizeof(hid_profile_report_t)) {
+    hid_profile_report_t report;
+    profile_stats_t stats;
+
+    profile_read(profile_probe, &stats);
+    memset(&report, 0, sizeof(report));
+    report.probe = profile_probe;
+    report.num_probes = PROFILE_NUM_PROBES;
+    report.counter_hz = profile_counter_hz();
+    report.count = stats.count;
+    report.min_cycles = stats.min_cycles;
+    report.max_cycles = stats.max_cycles;
+    report.total_cycles = stats.total_cycles;
+    strncpy(report.name, profile_probe_name(profile_probe), sizeof(report.name));
+
+    profile_probe = (profile_probe + 1) % PROFILE_NUM_PROBES;
+    memcpy(buffer, &report, sizeof(report));
+    return sizeof(report);
+  }
+#endif
+  return 0;
+}
+
+void usb_hid_set_feature(uint8_t report_id, const uint8_t *buffer, uint16_t len) {
+  if (report_id == USB_HID_REPORT_ID_CONFIG && len >= sizeof(hid_config_report_t)) {
+    hid_config_report_t report;
+    memcpy(&report, buffer, sizeof(report));
+    set_config_report(&report);
+  }
+#if JOYSTICK_PROFILE
+  if (report_id == USB_HID_REPORT_ID_PROFILE && len >= 1) {
+    if (buffer[0] == USB_HID_PROFILE_RESET) {
+      profile_reset();
+      profile_probe = 0;
+    } else if (buffer[0] < PROFILE_NUM_PROBES) {
+      profile_probe = buffer[0];
     }
   }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Optional device callback declared in TinyUSB's usbd.h
+//-----------------------------------------------------------------------------
+
+// Invoked when the device is configured, after enumeration. A new host starts
+// from the default idle rate and is sent the current state straight away,
+// rather than at the next tick.
+void tud_mount_cb(void) {
+  idle_ms = USB_HID_HEARTBEAT_MS;
+  report_sent = false;
+#if !USB_HID_FAST_POLL
+  send_hid_report = true;
+#endif
+  scheduler_post(SCHEDULER_EVENT_REPORT);
+}
+
+//-----------------------------------------------------------------------------
+// Optional HID callbacks declared in TinyUSB's hid_device.h
+//-----------------------------------------------------------------------------
+
+// Invoked when the host sets the idle rate, in units of 4 ms, with 0 meaning
+// only report on change. The next report waits for a change or for the new
+// duration to pass since the last one.
+bool tud_hid_set_idle_cb(uint8_t instance, uint8_t idle_rate) {
+  idle_ms = idle_rate * USB_HID_IDLE_RATE_UNIT_MS;
+  return true;
+}
+
+// Invoked when a report has been collected by the host
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len) {
+  // The endpoint is free for anything that was waiting on it
+  scheduler_post(SCHEDULER_EVENT_REPORT);
+
+  if (!in_flight.pending) {
+    return;
+  }
+  in_flight.pending = false;
+
+  uint32_t now_us = time_us_32();
+  latency_record(LATENCY_REPORT_TO_COMPLETE, now_us - in_flight.report_us);
+  latency_record(LATENCY_SAMPLE_TO_COMPLETE, now_us - in_flight.sample_us);
+  if (in_flight.has_edge) {
+    latency_record(LATENCY_EDGE_TO_COMPLETE, now_us - in_flight.edge_us);
+  }
 }
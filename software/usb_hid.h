@@ -9,23 +9,114 @@
 
 #include <stdint.h>
 
+#include "joystick.h"
+#include "profile.h"
+#include "tusb.h"
+
 //-----------------------------------------------------------------------------
 // Public constants
 //-----------------------------------------------------------------------------
 
+// Set to 1 to poll at the full-speed minimum of 1 ms, and send a report as soon
+// as the joystick state changes rather than on a fixed timer
+#ifndef USB_HID_FAST_POLL
+#define USB_HID_FAST_POLL 0
+#endif
+
+#if USB_HID_FAST_POLL
+#define USB_HID_POLL_INTERVAL_MS 1
+#else
 #define USB_HID_POLL_INTERVAL_MS 10
+#endif
+
+// Set to 1 to report each axis as a 16-bit value rather than 8 bits. The extra
+// bits only carry real information when the axes are oversampled, so this is
+// intended for use with JOYSTICK_ADC_DMA
+#ifndef USB_HID_16BIT_AXES
+#define USB_HID_16BIT_AXES 0
+#endif
+
+// Resend an unchanged report after this long, until the host sets its own
+// idle rate with SET_IDLE (0 to only send on change)
+#ifndef USB_HID_HEARTBEAT_MS
+#define USB_HID_HEARTBEAT_MS 100
+#endif
+
+// Largest movement, in steps of the reported axis value, that is ignored.
+// Anything up to this reads as the value last reported, so noise in the
+// bottom bit does not send reports of its own (0 to disable).
+#ifndef USB_HID_AXIS_HYSTERESIS
+#define USB_HID_AXIS_HYSTERESIS 1
+#endif
+
+// SET_IDLE durations are in units of 4 ms
+#define USB_HID_IDLE_RATE_UNIT_MS 4
+
+// HID report IDs, matching the descriptor in usb_descriptors.h
+#define USB_HID_REPORT_ID_JOYSTICK DEVICE_SPEC_REPORT_ID
+#define USB_HID_REPORT_ID_PROFILE 2  // Feature report, only with JOYSTICK_PROFILE
+#define USB_HID_REPORT_ID_CONFIG 3   // Feature report
+#define USB_HID_REPORT_ID_STATS 4    // Feature report, read only
+
+// Longest interval between reports that can be configured
+#define USB_HID_MAX_REPORT_INTERVAL_MS 1000
+
+// Writing this probe number to the profile feature report clears all stats
+#define USB_HID_PROFILE_RESET 0xFF
+
+// The joystick report, hid_joystick_report_t, and its descriptor are
+// generated from device_spec.json for the options above
+#include "device_spec_report.h"
+
+_Static_assert(DEVICE_SPEC_NUM_AXES == JOYSTICK_NUM_AXES && DEVICE_SPEC_NUM_BUTTONS == JOYSTICK_NUM_BUTTONS &&
+                   DEVICE_SPEC_AXIS_BITS == (USB_HID_16BIT_AXES ? 16 : 8),
+               "device_spec.json does not match the build options");
 
 //-----------------------------------------------------------------------------
 // Public types
 //-----------------------------------------------------------------------------
 
-// HID joystick protocol report, matching descriptor in usb_descriptors.h
+// Profile feature report. Reading it returns the selected probe's stats and
+// selects the next probe, so reading it repeatedly walks the whole table.
+// Writing it selects the probe given in the first byte.
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  probe;                   // Probe these stats are for
+  uint8_t  num_probes;
+  uint32_t counter_hz;              // Cycles per second, to convert to time
+  uint32_t count;
+  uint32_t min_cycles;
+  uint32_t max_cycles;
+  uint64_t total_cycles;
+  char     name[PROFILE_NAME_LEN];  // Not terminated if it fills the field
+}hid_profile_report_t;
+
+// Config feature report. Reading it returns the settings in use. Writing it
+// applies every field together, between two input reports, or none of them
+// if any is out of range. Settings are lost at reset.
+typedef struct TU_ATTR_PACKED
+{
+  uint16_t report_interval_ms;  // Time between checks for a changed state, or in fast poll mode the
+                                // least time between reports of one. Edges are always sent straight away.
+  uint16_t filter_window;       // Samples in a single moving average, or 0 for the built-in filter chain
+  uint16_t adc_clock_div;       // See JOYSTICK_ADC_CLOCK_DIV, ignored with RC-timed axes
+  uint16_t deadzone_permille;   // Deadzone of every axis, see calibration_axis_t
+}hid_config_report_t;
+
+// Stats feature report, a snapshot of the device as it runs
 typedef struct TU_ATTR_PACKED
 {
-  int8_t  x;         // 8-bit X axis data (-128 to 127)
-  int8_t  y;         // 8-bit Y axis data (-128 to 127)
-  uint8_t buttons;   // 2-bit button mask plus 6 bits of padding
-}hid_joystick_report_t;
+  uint32_t uptime_ms;
+  uint32_t reports_sent;
+  uint32_t edges_dropped;                  // Button edges lost to a full queue
+  uint16_t busy_permille;                  // Core 0 utilisation, see scheduler.h
+  uint16_t wakeups_per_second;
+  uint32_t latency_count;                  // Sample to report collected by the host, see latency.h
+  uint32_t latency_mean_us;
+  uint32_t latency_max_us;
+  uint32_t first_report_us;                // Time from reset to the first input report, 0 until it is sent
+  uint16_t axes[JOYSTICK_NUM_AXES];        // Filtered axis values, before calibration
+}hid_stats_report_t;
 
 
 //-----------------------------------------------------------------------------
@@ -35,7 +126,19 @@ typedef struct TU_ATTR_PACKED
 // Initialises a timer for requesting the HID reports
 void usb_init(void);
 
-// Task that generates a HID report for the joystick at the requested interval
+// Time from reset to the first input report, or 0 until it has been sent
+uint32_t usb_hid_first_report_us(void);
+
+// Fill in a feature report for a GET_REPORT request, returning its length,
+// or 0 if there is no such report
+uint16_t usb_hid_get_feature(uint8_t report_id, uint8_t *buffer, uint16_t reqlen);
+
+// Act on a feature report from a SET_REPORT request
+void usb_hid_set_feature(uint8_t report_id, const uint8_t *buffer, uint16_t len);
+
+// Task that generates a HID report for the joystick when its state has
+// changed, checking at the requested interval or whenever it changes in fast
+// poll mode, and when the idle rate set by the host expires
 void usb_task(void);
 
 #endif  // __USB_HID_H__